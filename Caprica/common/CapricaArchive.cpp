@@ -0,0 +1,233 @@
+#include <common/CapricaArchive.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <common/CapricaBinaryReader.h>
+#include <common/CapricaReportingContext.h>
+#include <common/CaselessStringComparer.h>
+#include <common/FSUtils.h>
+
+namespace caprica {
+
+static constexpr uint32_t archiveMagic = 0x4B415043; // 'CPAK'
+static constexpr uint32_t archiveVersion = 1;
+static constexpr size_t archiveHeaderSize = sizeof(uint32_t) * 3 + sizeof(uint64_t);
+// The number of files that can be waiting on the writer thread
+// before append starts blocking.
+static constexpr size_t maxQueuedEntries = 64;
+
+namespace {
+
+struct QueuedEntry final
+{
+  std::string path{ };
+  std::unique_ptr<char[]> data{ };
+  size_t size{ 0 };
+};
+
+struct DirectoryEntry final
+{
+  std::string path{ };
+  uint64_t offset{ 0 };
+  uint32_t size{ 0 };
+};
+
+struct ArchiveWriter final
+{
+  std::string baseDirectory{ };
+  std::ofstream strm{ };
+  std::vector<DirectoryEntry> directory{ };
+  uint64_t offset{ archiveHeaderSize };
+
+  std::mutex queueMutex{ };
+  std::condition_variable queueNotEmpty{ };
+  std::condition_variable queueNotFull{ };
+  std::deque<QueuedEntry> queue{ };
+  bool closing{ false };
+  std::thread thread{ };
+
+  template<typename T>
+  void writeValue(T val) {
+    strm.write((const char*)&val, sizeof(T));
+  }
+
+  void writeHeader() {
+    strm.seekp(0);
+    writeValue<uint32_t>(archiveMagic);
+    writeValue<uint32_t>(archiveVersion);
+    writeValue<uint32_t>((uint32_t)directory.size());
+    writeValue<uint64_t>(offset);
+  }
+
+  void run() {
+    while (true) {
+      QueuedEntry entry;
+      {
+        std::unique_lock<std::mutex> lock{ queueMutex };
+        queueNotEmpty.wait(lock, [this]() { return closing || !queue.empty(); });
+        if (queue.empty())
+          return;
+        entry = std::move(queue.front());
+        queue.pop_front();
+      }
+      queueNotFull.notify_one();
+
+      strm.write(entry.data.get(), entry.size);
+      directory.push_back(DirectoryEntry{ std::move(entry.path), offset, (uint32_t)entry.size });
+      offset += entry.size;
+    }
+  }
+};
+
+}
+
+static ArchiveWriter* writer{ nullptr };
+
+void CapricaArchive::openWriter(const std::string& archivePath, const std::string& baseDirectory) {
+  writer = new ArchiveWriter();
+  writer->baseDirectory = baseDirectory;
+  writer->strm.open(archivePath, std::ofstream::binary | std::ofstream::trunc);
+  if (!writer->strm.is_open())
+    CapricaReportingContext::logicalFatal("Unable to open the output archive '%s'!", archivePath.c_str());
+  writer->strm.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+  // Filled in properly once the directory has been written.
+  writer->writeHeader();
+  writer->thread = std::thread([]() { writer->run(); });
+}
+
+void CapricaArchive::append(const std::string& path, std::unique_ptr<char[]> data, size_t size) {
+  QueuedEntry entry{ };
+  entry.path = path;
+  if (entry.path.size() > writer->baseDirectory.size() &&
+      pathEq(identifier_ref(entry.path.data(), writer->baseDirectory.size()), writer->baseDirectory)) {
+    entry.path.erase(0, writer->baseDirectory.size());
+    while (entry.path.size() && (entry.path[0] == '\\' || entry.path[0] == '/'))
+      entry.path.erase(0, 1);
+  }
+  entry.data = std::move(data);
+  entry.size = size;
+
+  {
+    std::unique_lock<std::mutex> lock{ writer->queueMutex };
+    writer->queueNotFull.wait(lock, []() { return writer->queue.size() < maxQueuedEntries; });
+    writer->queue.push_back(std::move(entry));
+  }
+  writer->queueNotEmpty.notify_one();
+}
+
+void CapricaArchive::closeWriter() {
+  {
+    std::unique_lock<std::mutex> lock{ writer->queueMutex };
+    writer->closing = true;
+  }
+  writer->queueNotEmpty.notify_one();
+  writer->thread.join();
+
+  for (auto& e : writer->directory) {
+    writer->writeValue<uint16_t>((uint16_t)e.path.size());
+    writer->strm.write(e.path.data(), e.path.size());
+    writer->writeValue<uint64_t>(e.offset);
+    writer->writeValue<uint32_t>(e.size);
+  }
+  writer->writeHeader();
+  writer->strm.close();
+  delete writer;
+  writer = nullptr;
+}
+
+// Paths in the archive are relative to the directory it's extracted
+// to, so anything rooted, on a drive, UNC, or with a '..' in it is
+// rejected. Both separators are accepted by Windows, so both are
+// checked, and as Windows drops trailing dots and spaces from a
+// name, '...' and '.. ' count as '..' too.
+static bool isContainedPath(const std::string& path) {
+  if (path.empty() || path[0] == '\\' || path[0] == '/' || path.find(':') != std::string::npos)
+    return false;
+  size_t start = 0;
+  while (start <= path.size()) {
+    auto end = path.find_first_of("\\/", start);
+    if (end == std::string::npos)
+      end = path.size();
+    auto piece = std::string_view(path).substr(start, end - start);
+    if (piece.size() > 1 && piece.find_first_not_of(". ") == std::string_view::npos)
+      return false;
+    start = end + 1;
+  }
+  return true;
+}
+
+bool CapricaArchive::extract(const std::string& archivePath, const std::string& destDirectory) {
+  std::ifstream strm{ archivePath, std::ifstream::binary };
+  if (!strm.is_open()) {
+    std::cout << "Unable to open the archive '" << archivePath << "'." << std::endl;
+    return false;
+  }
+  std::stringstream contents{ };
+  contents << strm.rdbuf();
+  auto data = contents.str();
+  std::string_view view{ data };
+
+  CapricaBinaryReader header{ view };
+  if (view.size() < archiveHeaderSize || header.read<uint32_t>() != archiveMagic) {
+    std::cout << "'" << archivePath << "' is not a Caprica archive." << std::endl;
+    return false;
+  }
+  if (header.read<uint32_t>() != archiveVersion) {
+    std::cout << "'" << archivePath << "' was written by an unsupported version of Caprica." << std::endl;
+    return false;
+  }
+  auto entryCount = header.read<uint32_t>();
+  auto directoryOffset = header.read<uint64_t>();
+  if (directoryOffset > view.size()) {
+    std::cout << "The directory of the archive '" << archivePath << "' is missing." << std::endl;
+    return false;
+  }
+
+  auto destRoot = FSUtils::canonical(destDirectory);
+  if (destRoot.empty() || (destRoot.back() != '\\' && destRoot.back() != '/'))
+    destRoot += "\\";
+  CapricaBinaryReader dir{ view.substr((size_t)directoryOffset) };
+  for (size_t i = 0; i < entryCount; i++) {
+    // Each entry is the size of its path, the path, then the
+    // offset and size of its data.
+    if (dir.remaining() < sizeof(uint16_t)) {
+      std::cout << "The directory of the archive '" << archivePath << "' is truncated." << std::endl;
+      return false;
+    }
+    auto pathSize = dir.read<uint16_t>();
+    if (dir.remaining() < pathSize + sizeof(uint64_t) + sizeof(uint32_t)) {
+      std::cout << "The directory of the archive '" << archivePath << "' is truncated." << std::endl;
+      return false;
+    }
+    auto path = std::string(dir.readBytes(pathSize));
+    auto offset = dir.read<uint64_t>();
+    auto size = dir.read<uint32_t>();
+    if (!isContainedPath(path)) {
+      std::cout << "The archive '" << archivePath << "' contains the invalid path '" << path << "'." << std::endl;
+      return false;
+    }
+    if (offset > directoryOffset || size > directoryOffset - offset) {
+      std::cout << "The data for '" << path << "' is outside of the archive '" << archivePath << "'." << std::endl;
+      return false;
+    }
+
+    auto destPath = FSUtils::canonical(destRoot + path);
+    if (destPath.size() <= destRoot.size() || !pathEq(std::string_view(destPath).substr(0, destRoot.size()), std::string_view(destRoot))) {
+      std::cout << "The archive '" << archivePath << "' contains the invalid path '" << path << "'." << std::endl;
+      return false;
+    }
+    FSUtils::createDirectories(std::string(FSUtils::parentPathAsRef(destPath)));
+    FSUtils::writeFile(destPath, data.data() + offset, size);
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace caprica {
+
+// A single file holding all of the compiled output, so that it
+// can be written as one sequential stream rather than as thousands
+// of small files.
+//
+// The layout, with everything little-endian, is:
+//   uint32 magic ('CPAK'), uint32 version, uint32 entry count,
+//   uint64 offset of the directory,
+//   the data of each entry, back to back,
+//   then for each entry in the directory:
+//     uint16 path length, the path relative to the output
+//     directory, uint64 offset of the data, uint32 size.
+struct CapricaArchive final
+{
+  // Start the writer thread for a new archive at archivePath. The
+  // paths of appended files are stored relative to baseDirectory.
+  static void openWriter(const std::string& archivePath, const std::string& baseDirectory);
+  // Queue a file to be written to the archive. This blocks if the
+  // writer thread has fallen too far behind.
+  static void append(const std::string& path, std::unique_ptr<char[]> data, size_t size);
+  // Wait for everything queued to be written, then write the directory.
+  static void closeWriter();
+
+  // Extract every file in the archive into destDirectory. Returns
+  // false, after reporting why, if the archive couldn't be read.
+  static bool extract(const std::string& archivePath, const std::string& destDirectory);
+};
+
+}
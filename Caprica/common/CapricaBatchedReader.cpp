@@ -0,0 +1,99 @@
+#include <common/CapricaBatchedReader.h>
+
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include <Windows.h>
+
+namespace caprica {
+
+// The number of reads in flight at once, and the number of
+// completions collected per call.
+static constexpr size_t maxReadsInFlight = 64;
+
+namespace {
+
+struct PendingRead final
+{
+  // Must be first, as the completion only gives us this.
+  OVERLAPPED overlapped{ };
+  HANDLE file{ INVALID_HANDLE_VALUE };
+  CapricaBatchedReader::Request request{ };
+};
+
+}
+
+static HANDLE completionPort{ nullptr };
+static std::thread readerThread{ };
+
+static bool issueRead(PendingRead* read) {
+  auto& req = read->request;
+  if (req.size >= std::numeric_limits<DWORD>::max())
+    return false;
+  read->file = CreateFileA(req.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (read->file == INVALID_HANDLE_VALUE)
+    return false;
+  if (!CreateIoCompletionPort(read->file, completionPort, 0, 0)) {
+    CloseHandle(read->file);
+    return false;
+  }
+  // Asking for one more byte than expected tells us if the file
+  // has grown since its size was found.
+  if (!ReadFile(read->file, req.buffer, (DWORD)req.size + 1, nullptr, &read->overlapped) && GetLastError() != ERROR_IO_PENDING) {
+    CloseHandle(read->file);
+    return false;
+  }
+  return true;
+}
+
+static void readerMain(std::vector<CapricaBatchedReader::Request> requests) {
+  size_t next = 0;
+  size_t inFlight = 0;
+  OVERLAPPED_ENTRY entries[maxReadsInFlight];
+  while (next < requests.size() || inFlight) {
+    while (inFlight < maxReadsInFlight && next < requests.size()) {
+      auto read = new PendingRead();
+      read->request = std::move(requests[next++]);
+      if (issueRead(read)) {
+        inFlight++;
+      } else {
+        read->request.onComplete(false);
+        delete read;
+      }
+    }
+    if (!inFlight)
+      continue;
+
+    ULONG removed = 0;
+    if (!GetQueuedCompletionStatusEx(completionPort, entries, (ULONG)maxReadsInFlight, &removed, INFINITE, FALSE))
+      continue;
+    for (ULONG i = 0; i < removed; i++) {
+      auto read = (PendingRead*)entries[i].lpOverlapped;
+      DWORD transferred = 0;
+      bool succeeded = GetOverlappedResult(read->file, &read->overlapped, &transferred, FALSE) &&
+                       transferred == read->request.size;
+      CloseHandle(read->file);
+      inFlight--;
+      read->request.onComplete(succeeded);
+      delete read;
+    }
+  }
+  CloseHandle(completionPort);
+  completionPort = nullptr;
+}
+
+bool CapricaBatchedReader::start(std::vector<Request>&& requests) {
+  completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if (!completionPort)
+    return false;
+  readerThread = std::thread(readerMain, std::move(requests));
+  return true;
+}
+
+void CapricaBatchedReader::join() {
+  if (readerThread.joinable())
+    readerThread.join();
+}
+
+}
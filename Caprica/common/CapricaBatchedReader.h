@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace caprica {
+
+// Reads many files at once with overlapped I/O on a completion
+// port, so that the thread issuing them never waits on a single
+// read, and completions are collected in batches.
+struct CapricaBatchedReader final
+{
+  struct Request final
+  {
+    std::string path{ };
+    // Must have room for at least size + 1 bytes, so that a file
+    // that has grown since its size was found can be detected.
+    char* buffer{ nullptr };
+    size_t size{ 0 };
+    // Called on the reader's thread with whether the whole file,
+    // and nothing more, was read into the buffer.
+    std::function<void(bool)> onComplete{ };
+  };
+
+  // Start reading on a thread of its own. Returns false, having
+  // read nothing and leaving the requests as they were, if a
+  // completion port isn't available.
+  static bool start(std::vector<Request>&& requests);
+  // Wait for every read to have completed.
+  static void join();
+};
+
+}
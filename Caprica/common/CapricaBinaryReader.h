@@ -1,24 +1,46 @@
 #pragma once
 
 #include <cstdint>
-#include <fstream>
-#include <iostream>
-#include <memory>
+#include <cstring>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+
+#include <common/identifier_ref.h>
 
 namespace caprica {
 
+// Reads from a buffer that's already in memory. Pex is
+// little-endian, as is everything we run on, so the loads
+// are plain copies, each checked against the end of the data.
 struct CapricaBinaryReader
 {
-  explicit CapricaBinaryReader(const std::string& file) : strm(file, std::ifstream::binary) {
-    strm.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-  }
+  // Thrown when the data ends before a read does. That's a problem
+  // with the file being read rather than with Caprica, so it's left
+  // to the caller to report it against that file.
+  struct UnexpectedEndOfData final : public std::runtime_error
+  {
+    UnexpectedEndOfData() : std::runtime_error("") { }
+  };
+
+  // The data must outlive the reader, along with anything
+  // returned by read<identifier_ref>().
+  explicit CapricaBinaryReader(std::string_view data) : cur(data.data()), end(data.data() + data.size()) { }
   CapricaBinaryReader(const CapricaBinaryReader&) = delete;
   ~CapricaBinaryReader() = default;
 
   bool eof() {
-    strm.peek();
-    return strm.eof();
+    return cur == end;
+  }
+
+  size_t remaining() const {
+    return (size_t)(end - cur);
+  }
+
+  // Read the next len bytes as they are, referring directly
+  // into the data.
+  std::string_view readBytes(size_t len) {
+    return std::string_view(take(len), len);
   }
 
   template<typename T>
@@ -28,71 +50,81 @@ struct CapricaBinaryReader
 
   template<>
   int8_t read() {
-    int8_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<int8_t>();
   }
 
   template<>
   uint8_t read() {
-    uint8_t val = 0;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<uint8_t>();
   }
 
   template<>
   int16_t read() {
-    int16_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<int16_t>();
   }
 
   template<>
   uint16_t read() {
-    uint16_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<uint16_t>();
   }
 
   template<>
   int32_t read() {
-    int32_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<int32_t>();
   }
 
   template<>
   uint32_t read() {
-    uint32_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<uint32_t>();
+  }
+
+  template<>
+  uint64_t read() {
+    return load<uint64_t>();
   }
 
   template<>
   float read() {
-    float val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<float>();
   }
 
   template<>
   time_t read() {
     static_assert(sizeof(time_t) == 8, "time_t is not 64 bits");
-    time_t val;
-    strm.read((char*)&val, sizeof(val));
-    return val;
+    return load<time_t>();
   }
 
+  // Refers directly into the data, without copying it.
   template<>
-  std::string read() {
+  identifier_ref read() {
     auto len = read<uint16_t>();
-    std::unique_ptr<char[]> buf(new char[len]);
-    strm.read(buf.get(), len);
-    return std::string(buf.get(), buf.get() + len);
+    return identifier_ref(take(len), len);
+  }
+
+  template<>
+  std::string read() {
+    return read<identifier_ref>().to_string();
   }
 
 protected:
-  std::ifstream strm;
+  const char* cur;
+  const char* end;
+
+  // Skip past the next len bytes, returning where they start.
+  const char* take(size_t len) {
+    if (remaining() < len)
+      throw UnexpectedEndOfData();
+    auto ret = cur;
+    cur += len;
+    return ret;
+  }
+
+  template<typename T>
+  T load() {
+    T val;
+    memcpy(&val, take(sizeof(T)), sizeof(T));
+    return val;
+  }
 };
 
 }
@@ -2,11 +2,15 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
 #include <string_view>
 
+#include <common/CapricaReportingContext.h>
 #include <common/FSUtils.h>
-#include <common/allocators/ChainedPool.h>
+#include <common/UtilMacros.h>
+#include <common/identifier_ref.h>
 
 namespace caprica {
 
@@ -14,13 +18,31 @@ struct CapricaBinaryWriter
 {
   explicit CapricaBinaryWriter() = default;
   CapricaBinaryWriter(const CapricaBinaryWriter&) = delete;
-  ~CapricaBinaryWriter() = default;
+  ~CapricaBinaryWriter() {
+    free(buffer);
+  }
+
+  // Make room for the whole output up front, so that it's
+  // written without ever having to grow the buffer.
+  void reserve(size_t size) {
+    if (capacity - length < size)
+      grow(size);
+  }
 
   template<typename F>
   void applyToBuffers(F&& func) {
-    for (auto beg = strm.begin(), end = strm.end(); beg != end; ++beg) {
-      func(beg.data(), beg.size());
-    }
+    if (length)
+      func(buffer, length);
+  }
+
+  size_t writtenBytes() const {
+    return length;
+  }
+
+  // The memory held by the buffer, which may be more
+  // than the size of the data written.
+  size_t allocatedBytes() const {
+    return capacity;
   }
 
   template<typename T>
@@ -36,43 +58,43 @@ struct CapricaBinaryWriter
 
   template<>
   void write(int8_t val) {
-    strm.make<int8_t>(val);
+    put<int8_t>(val);
   }
 
   template<>
   void write(uint8_t val) {
-    strm.make<uint8_t>(val);
+    put<uint8_t>(val);
   }
 
   template<>
   void write(int16_t val) {
-    strm.make<int16_t>(val);
+    put<int16_t>(val);
   }
 
   template<>
   void write(uint16_t val) {
-    strm.make<uint16_t>(val);
+    put<uint16_t>(val);
   }
 
   template<>
   void write(int32_t val) {
-    strm.make<int32_t>(val);
+    put<int32_t>(val);
   }
 
   template<>
   void write(uint32_t val) {
-    strm.make<uint32_t>(val);
+    put<uint32_t>(val);
   }
 
   template<>
   void write(float val) {
-    strm.make<float>(val);
+    put<float>(val);
   }
 
   template<>
   void write(time_t val) {
     static_assert(sizeof(time_t) == 8, "time_t is not 64 bits");
-    strm.make<time_t>(val);
+    put<time_t>(val);
   }
 
   template<>
@@ -90,10 +112,39 @@ struct CapricaBinaryWriter
   }
 
 protected:
-  allocators::ChainedPool strm{ 1024 * 4 };
+  char* buffer{ nullptr };
+  size_t length{ 0 };
+  size_t capacity{ 0 };
+
+  NEVER_INLINE void grow(size_t size) {
+    auto newCapacity = capacity * 2;
+    if (newCapacity < length + size)
+      newCapacity = length + size;
+    if (newCapacity < 1024 * 4)
+      newCapacity = 1024 * 4;
+    auto newBuffer = (char*)realloc(buffer, newCapacity);
+    if (!newBuffer)
+      CapricaReportingContext::logicalFatal("Failed to grow the output buffer to %zu bytes!", newCapacity);
+    buffer = newBuffer;
+    capacity = newCapacity;
+  }
+
+  // Every scalar goes through here, so the only work beyond the
+  // copy is a single check that almost never fails once the
+  // buffer has been reserved.
+  template<typename T>
+  ALWAYS_INLINE void put(T val) {
+    if (capacity - length < sizeof(T))
+      grow(sizeof(T));
+    memcpy(buffer + length, &val, sizeof(T));
+    length += sizeof(T);
+  }
 
   void append(const char* __restrict a, size_t size) {
-    memcpy(strm.allocate(size), a, size);
+    if (capacity - length < size)
+      grow(size);
+    memcpy(buffer + length, a, size);
+    length += size;
   }
 };
 
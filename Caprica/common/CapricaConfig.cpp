@@ -6,8 +6,16 @@ namespace caprica { namespace conf {
 // default values set in the command line parsing.
 
 namespace General {
+  bool atomicWrite{ false };
   bool compileInParallel{ false };
+  std::string diffDirectory{ "" };
+  std::string extractArchive{ "" };
+  bool includeAsmFiles{ false };
+  std::string outputArchive{ "" };
   bool quietCompile{ false };
+  bool skipUnchangedOutput{ false };
+  bool skipUnchangedIgnoreTime{ false };
+  bool wholeProgramAnalysis{ false };
 }
 
 namespace CodeGeneration {
@@ -15,12 +23,21 @@ namespace CodeGeneration {
   bool disableDebugCode{ false };
   bool enableCKOptimizations{ false };
   bool enableOptimizations{ false };
+  size_t optimizationLevel{ 0 };
+  bool enableLoopInvariantHoisting{ true };
+  size_t inlineThreshold{ 0 };
+  std::string profileUseFile{ "" };
+  size_t profileHotCallCount{ 0 };
   bool emitDebugInfo{ false };
+  bool debugLineMapSidecar{ false };
 }
 
 namespace Debug {
+  size_t benchmarkPexWriterIterations{ 0 };
   bool debugControlFlowGraph{ false };
   bool dumpPexAsm{ false };
+  bool dumpOptimizationStats{ false };
+  std::string optimizationRemarksFile{ "" };
 }
 
 namespace EngineLimits {
@@ -49,6 +66,7 @@ namespace Papyrus {
 namespace Performance {
   bool asyncFileRead{ false };
   bool asyncFileWrite{ false };
+  bool batchedFileRead{ false };
   bool dumpTiming{ false };
   bool performanceTestMode{ false };
   bool resolveSymlinks{ false };
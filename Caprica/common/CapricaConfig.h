@@ -11,11 +11,36 @@ namespace caprica { namespace conf {
 
 // Options that don't fit in any other category.
 namespace General {
+  // If true, write each output file to a temporary file first,
+  // and then rename it into place, so that an interrupted
+  // compile never leaves a partially written file.
+  extern bool atomicWrite;
   // If true, when compiling multiple files, do so
   // in multiple threads.
   extern bool compileInParallel;
+  // If set, compare the Pex files in the directory passed against
+  // those in this directory rather than compiling anything.
+  extern std::string diffDirectory;
+  // If set, extract the compiled files in this archive to the
+  // output directory rather than compiling anything.
+  extern std::string extractArchive;
+  // If true, Pex files (*.pex) in the directories passed are
+  // disassembled, and Pex assembly files (*.pas) assembled.
+  extern bool includeAsmFiles;
+  // If set, write the compiled files into this archive rather
+  // than as loose files in the output directory.
+  extern std::string outputArchive;
   // If true, only report failures, not progress.
   extern bool quietCompile;
+  // If true, leave output files whose contents wouldn't change
+  // untouched, so that their modification times are kept.
+  extern bool skipUnchangedOutput;
+  // If true, a difference in only the compilation time doesn't
+  // count as a change when skipping unchanged output.
+  extern bool skipUnchangedIgnoreTime;
+  // If true, once everything is compiled, report the functions and
+  // properties that nothing in the compiled scripts references.
+  extern bool wholeProgramAnalysis;
 }
 
 // Options related to code generation.
@@ -28,20 +53,55 @@ namespace CodeGeneration {
   // switch is passed to the CK compiler.
   extern bool enableCKOptimizations;
   // Enable optimizations normally enabled by the -optimize switch to the
-  // CK compiler.
+  // CK compiler. This is set whenever optimizationLevel is above 0.
   extern bool enableOptimizations;
+  // The level of optimization to perform on the generated Pex.
+  // 0 disables optimization, 1 performs branch threading and cleanup,
+  // and 2 additionally performs copy propagation, common subexpression
+  // elimination, dead store elimination, and loop invariant hoisting.
+  extern size_t optimizationLevel;
+  // If true, and optimizationLevel is at least 2, move invariant
+  // array lengths and auto property reads out of loops.
+  extern bool enableLoopInvariantHoisting;
+  // The largest Global function, in instructions, whose body is
+  // substituted for calls to it when optimizations are enabled.
+  // 0 disables inlining.
+  extern size_t inlineThreshold;
+  // If not empty, the in-game profiling log of call counts per
+  // function used to decide which functions are hot.
+  extern std::string profileUseFile;
+  // The number of calls in the profile at which a function is
+  // considered hot. Hot functions are optimized as if optimizationLevel
+  // were at least 2, while cold functions only get the level 1 passes
+  // and aren't expanded by codegen.
+  extern size_t profileHotCallCount;
   // If true, emit debug info for the papyrus script.
   extern bool emitDebugInfo;
+  // If true, along with emitDebugInfo, write the line numbers of
+  // each instruction to a file alongside the Pex file rather than
+  // in it, leaving only the property groups and struct orders.
+  extern bool debugLineMapSidecar;
 }
 
 // Options related to debugging Caprica itself.
 namespace Debug {
+  // If non-zero, write each compiled file this many more times,
+  // with and without sizing the buffer first, and report the
+  // time taken.
+  extern size_t benchmarkPexWriterIterations;
   // If true, output the control flow graph of every function in the
   // files being compiled to stdout.
   extern bool debugControlFlowGraph;
   // If true, dump the Asm representation of the Pex file generated
   // for the Papyrus scripts being compiled.
   extern bool dumpPexAsm;
+  // If true, output the number of instructions removed by the
+  // optimizer for every file being compiled, and the total removed
+  // by each peephole pattern.
+  extern bool dumpOptimizationStats;
+  // If not empty, the file to write a line of JSON to for every
+  // change an optimization pass makes to a function.
+  extern std::string optimizationRemarksFile;
 }
 
 // Limitations of the game engine, not of Caprica.
@@ -95,12 +155,17 @@ namespace Performance {
   // If true, read files asyncronously in an attempt to pre-emptively
   // read them from disk. This results in worse performance on HDDs,
   // but better performance on SSDs, as they are actually able to read
-  // multiple files at once.
+  // multiple files at once. Otherwise, they're read one at a
+  // time, in order, on a thread of their own.
   extern bool asyncFileRead;
   // If true, write files to disk on background threads, allowing
   // the main compile threads to keep working while waiting for the
   // disk to catch up.
   extern bool asyncFileWrite;
+  // If true, read files many at a time with overlapped I/O on a
+  // completion port, queueing each file's parse as soon as its
+  // read completes. This only applies along with asyncFileRead.
+  extern bool batchedFileRead;
   // If true, output timing stats.
   extern bool dumpTiming;
   // If true, we pause and wait for all files to be read in before
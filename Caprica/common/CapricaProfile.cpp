@@ -0,0 +1,92 @@
+#include <common/CapricaProfile.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include <common/CapricaConfig.h>
+#include <common/CaselessStringComparer.h>
+
+namespace caprica {
+
+// Keyed by `object.state.function`, with an empty state
+// for the empty state.
+static caseless_unordered_identifier_map<size_t> callCounts{ };
+static bool profileLoaded{ false };
+
+static std::string makeKey(identifier_ref objectName, identifier_ref stateName, identifier_ref functionName) {
+  std::string key{ };
+  key.reserve(objectName.size() + stateName.size() + functionName.size() + 2);
+  key.append(objectName.data(), objectName.size());
+  key.push_back('.');
+  key.append(stateName.data(), stateName.size());
+  key.push_back('.');
+  key.append(functionName.data(), functionName.size());
+  return key;
+}
+
+static bool isSeparator(char c) {
+  return c == ' ' || c == '\t' || c == ',';
+}
+
+bool CapricaProfile::load(const std::string& path) {
+  std::ifstream strm{ path, std::ifstream::binary };
+  if (!strm.is_open()) {
+    std::cout << "Unable to open the profile '" << path << "'." << std::endl;
+    return false;
+  }
+
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(strm, line)) {
+    lineNumber++;
+    while (line.size() && (line.back() == '\r' || isSeparator(line.back())))
+      line.pop_back();
+    size_t start = 0;
+    while (start < line.size() && isSeparator(line[start]))
+      start++;
+    if (start == line.size() || line[start] == ';' || line[start] == '#')
+      continue;
+
+    auto countStart = line.size();
+    while (countStart > start && !isSeparator(line[countStart - 1]))
+      countStart--;
+    auto nameEnd = countStart;
+    while (nameEnd > start && isSeparator(line[nameEnd - 1]))
+      nameEnd--;
+
+    char* countEnd = nullptr;
+    auto count = std::strtoull(line.c_str() + countStart, &countEnd, 10);
+    if (nameEnd == start || !std::isdigit((unsigned char)line[countStart]) || countEnd != line.c_str() + line.size()) {
+      std::cout << "Invalid entry on line " << lineNumber << " of the profile '" << path << "'. Expected 'Object.State.Function Count'." << std::endl;
+      return false;
+    }
+
+    identifier_ref name{ line.c_str() + start, nameEnd - start };
+    auto firstDot = name.find('.');
+    auto lastDot = name.rfind('.');
+    if (firstDot == identifier_ref::npos) {
+      std::cout << "Invalid function name '" << name.to_string() << "' on line " << lineNumber << " of the profile '" << path << "'. Expected 'Object.State.Function' or 'Object.Function'." << std::endl;
+      return false;
+    }
+    auto objectName = name.substr(0, firstDot);
+    auto stateName = firstDot == lastDot ? identifier_ref("") : name.substr(firstDot + 1, lastDot - firstDot - 1);
+    auto functionName = name.substr(lastDot + 1);
+    callCounts[makeKey(objectName, stateName, functionName)] += (size_t)count;
+  }
+  profileLoaded = true;
+  return true;
+}
+
+CapricaProfileHotness CapricaProfile::classify(identifier_ref objectName, identifier_ref stateName, identifier_ref functionName) {
+  if (!profileLoaded)
+    return CapricaProfileHotness::Unknown;
+
+  auto f = callCounts.find(makeKey(objectName, stateName, functionName));
+  if (f != callCounts.end() && f->second >= conf::CodeGeneration::profileHotCallCount)
+    return CapricaProfileHotness::Hot;
+  return CapricaProfileHotness::Cold;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include <common/identifier_ref.h>
+
+namespace caprica {
+
+enum class CapricaProfileHotness
+{
+  // No profile was given, or the function isn't one the
+  // profile can describe.
+  Unknown,
+  // Called fewer than conf::CodeGeneration::profileHotCallCount
+  // times, or not at all. Kept compact.
+  Cold,
+  // Worth spending the expensive optimizations on.
+  Hot,
+};
+
+// Call counts per function from an in-game script profiling log.
+//
+// Each line of the file is `Object.State.Function Count`, or
+// `Object.Function Count` for functions in the empty state. The
+// name and count may be separated by whitespace or a comma. Blank
+// lines and lines starting with ';' or '#' are ignored, and the
+// counts of repeated functions are summed.
+struct CapricaProfile final
+{
+  // Load the profile. This must be done before anything is compiled.
+  // Returns false, after reporting why, if it couldn't be loaded.
+  static bool load(const std::string& path);
+
+  static CapricaProfileHotness classify(identifier_ref objectName, identifier_ref stateName, identifier_ref functionName);
+};
+
+}
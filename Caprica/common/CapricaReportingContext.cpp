@@ -83,12 +83,16 @@ void CapricaReportingContext::maybePushMessage(CapricaReportingContext* ctx, Cap
     if (ctx->isWarningEnabled(*location, warningNumber)) {
       if (ctx->isWarningError(*location, warningNumber)) {
         ctx->errorCount++;
-        pushToErrorStream(ctx->formatLocation(*location) + ": Error W" + std::to_string(warningNumber) + ": " + msg, true);
+        if (!ctx->silent)
+          pushToErrorStream(ctx->formatLocation(*location) + ": Error W" + std::to_string(warningNumber) + ": " + msg, true);
       } else {
         ctx->warningCount++;
-        pushToErrorStream(ctx->formatLocation(*location) + ": Warning W" + std::to_string(warningNumber) + ": " + msg);
+        if (!ctx->silent)
+          pushToErrorStream(ctx->formatLocation(*location) + ": Warning W" + std::to_string(warningNumber) + ": " + msg);
       }
     }
+  } else if (ctx != nullptr && ctx->silent) {
+    return;
   } else if (location != nullptr) {
     pushToErrorStream(ctx->formatLocation(*location) + ": " + msgType + ": " + msg, forceAsError);
   } else {
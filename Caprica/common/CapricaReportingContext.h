@@ -18,6 +18,10 @@ struct CapricaReportingContext final
   std::string filename;
   size_t warningCount{ 0 };
   size_t errorCount{ 0 };
+  // Count what would be reported, but don't print any of it. This
+  // is for code that's processed a second time, where everything
+  // worth reporting already was the first time.
+  bool silent{ false };
 
   CapricaReportingContext() = delete;
   CapricaReportingContext(const CapricaReportingContext& other) = delete;
@@ -90,6 +94,8 @@ NEVER_INLINE void warning_W##num##_##id##(CapricaFileLocation location, arg1Type
   DEFINE_WARNING_A1(4005, Unwritten_Script_Variable, "The script variable '%s' is not initialized, and is never written to.", const char*, variableName)
   DEFINE_WARNING_A1(4006, Script_Variable_Only_Written, "The script variable '%s' is only ever written to.", const char*, variableName)
   DEFINE_WARNING_A1(4007, Script_Variable_Initialized_Never_Used, "The script variable '%s' is initialized but is never used.", const char*, variableName)
+  DEFINE_WARNING_A1(4008, Uncalled_Function, "The function '%s' is never called by any of the scripts being compiled.", const char*, functionName)
+  DEFINE_WARNING_A1(4009, Unreferenced_Property, "The property '%s' is never used by any of the scripts being compiled.", const char*, propertyName)
 
 #undef DEFINE_WARNING_A1
 #undef DEFINE_WARNING_A2
@@ -37,6 +37,13 @@ const CapricaUserFlagsDefinition::UserFlag& CapricaUserFlagsDefinition::findFlag
   return userFlags[a->second];
 }
 
+const CapricaUserFlagsDefinition::UserFlag* CapricaUserFlagsDefinition::tryFindFlag(const std::string& name) const {
+  auto a = flagNameMap.find(name);
+  if (a == flagNameMap.end())
+    return nullptr;
+  return &userFlags[a->second];
+}
+
 const CapricaUserFlagsDefinition::UserFlag& CapricaUserFlagsDefinition::getFlag(size_t flagNum) const {
   return userFlags[flagNum];
 }
@@ -46,6 +46,8 @@ struct CapricaUserFlagsDefinition final
 
   void registerUserFlag(CapricaReportingContext& repCtx, const UserFlag& flag);
   const UserFlag& findFlag(CapricaReportingContext& repCtx, CapricaFileLocation loc, const std::string& name) const;
+  // Returns nullptr if no flag by the name was defined.
+  const UserFlag* tryFindFlag(const std::string& name) const;
   // Not that flag num is NOT the flag's bit index, it is instead
   // the flag's index in the user flags vector.
   const UserFlag& getFlag(size_t flagNum) const;
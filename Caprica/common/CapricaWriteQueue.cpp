@@ -0,0 +1,80 @@
+#include <common/CapricaWriteQueue.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace caprica {
+
+namespace {
+
+struct QueuedWrite final
+{
+  size_t bytes{ 0 };
+  std::function<void()> write{ };
+};
+
+}
+
+static std::mutex queueMutex{ };
+static std::condition_variable queueNotEmpty{ };
+static std::condition_variable queueNotFull{ };
+static std::deque<QueuedWrite> queuedWrites{ };
+static std::vector<std::thread> ioThreads{ };
+static size_t maxBytes{ 0 };
+static size_t queuedBytes{ 0 };
+static bool stopping{ false };
+
+static void ioThreadMain() {
+  while (true) {
+    QueuedWrite w;
+    {
+      std::unique_lock<std::mutex> lock{ queueMutex };
+      queueNotEmpty.wait(lock, []() { return stopping || !queuedWrites.empty(); });
+      if (queuedWrites.empty())
+        return;
+      w = std::move(queuedWrites.front());
+      queuedWrites.pop_front();
+    }
+    w.write();
+    {
+      std::unique_lock<std::mutex> lock{ queueMutex };
+      queuedBytes -= w.bytes;
+    }
+    queueNotFull.notify_all();
+  }
+}
+
+void CapricaWriteQueue::startup(size_t threadCount, size_t maxQueuedBytes) {
+  maxBytes = maxQueuedBytes;
+  stopping = false;
+  for (size_t i = 0; i < threadCount; i++)
+    ioThreads.emplace_back(ioThreadMain);
+}
+
+void CapricaWriteQueue::queue(size_t bytes, std::function<void()>&& write) {
+  {
+    std::unique_lock<std::mutex> lock{ queueMutex };
+    // A single write larger than the limit still has to go through.
+    queueNotFull.wait(lock, [bytes]() { return !queuedBytes || queuedBytes + bytes <= maxBytes; });
+    queuedBytes += bytes;
+    queuedWrites.push_back(QueuedWrite{ bytes, std::move(write) });
+  }
+  queueNotEmpty.notify_one();
+}
+
+void CapricaWriteQueue::shutdown() {
+  {
+    std::unique_lock<std::mutex> lock{ queueMutex };
+    stopping = true;
+  }
+  queueNotEmpty.notify_all();
+  for (auto& t : ioThreads)
+    t.join();
+  ioThreads.clear();
+}
+
+}
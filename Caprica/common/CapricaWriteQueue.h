@@ -0,0 +1,21 @@
+#pragma once
+
+#include <functional>
+
+namespace caprica {
+
+// Moves writing output to disk off of the compile workers. Writes are
+// run on dedicated I/O threads, and queueing one blocks while the
+// memory held by those still waiting is over the limit, so that
+// compiling can't get arbitrarily far ahead of the disk.
+struct CapricaWriteQueue final
+{
+  static void startup(size_t threadCount, size_t maxQueuedBytes);
+  // Run the write on an I/O thread. bytes is the memory that's
+  // held until it has.
+  static void queue(size_t bytes, std::function<void()>&& write);
+  // Wait for everything queued to be written, and stop the threads.
+  static void shutdown();
+};
+
+}
@@ -2,16 +2,21 @@
 
 #include <io.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #include <cstring>
 #include <filesystem>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <sstream>
 
 #include <common/CapricaConfig.h>
 #include <common/CapricaReportingContext.h>
 #include <common/CaselessStringComparer.h>
 
+#include <Windows.h>
+
 namespace filesystem = std::experimental::filesystem;
 
 namespace caprica { namespace FSUtils {
@@ -85,4 +90,53 @@ std::string canonical(const std::string& path) {
   }
 }
 
+static std::mutex knownDirectoriesMutex{ };
+static caseless_unordered_path_set knownDirectories{ };
+
+void createDirectories(const std::string& path) {
+  {
+    std::unique_lock<std::mutex> lock{ knownDirectoriesMutex };
+    if (knownDirectories.count(path))
+      return;
+  }
+  // create_directories is fine with the directory already existing,
+  // so two threads racing to create it isn't a problem.
+  filesystem::create_directories(path);
+  std::unique_lock<std::mutex> lock{ knownDirectoriesMutex };
+  knownDirectories.insert(path);
+}
+
+bool fileMatches(const std::string& path, const char* data, size_t size, size_t ignoredOffset, size_t ignoredSize) {
+  auto fd = _open(path.c_str(), _O_BINARY | _O_RDONLY | _O_SEQUENTIAL);
+  if (fd == -1)
+    return false;
+  if ((size_t)_filelengthi64(fd) != size) {
+    _close(fd);
+    return false;
+  }
+  std::unique_ptr<char[]> existing{ new char[size] };
+  auto len = _read(fd, existing.get(), (unsigned int)size);
+  _close(fd);
+  if (len < 0 || (size_t)len != size)
+    return false;
+
+  if (ignoredOffset + ignoredSize > size)
+    ignoredOffset = ignoredSize = 0;
+  return !memcmp(existing.get(), data, ignoredOffset) &&
+         !memcmp(existing.get() + ignoredOffset + ignoredSize, data + ignoredOffset + ignoredSize, size - ignoredOffset - ignoredSize);
+}
+
+void writeFile(const std::string& path, const char* data, size_t size) {
+  auto destPath = conf::General::atomicWrite ? path + ".tmp" : path;
+  auto fd = _open(destPath.c_str(), _O_BINARY | _O_WRONLY | _O_CREAT | _O_TRUNC | _O_SEQUENTIAL, _S_IREAD | _S_IWRITE);
+  if (fd == -1)
+    CapricaReportingContext::logicalFatal("Unable to open '%s' for writing!", destPath.c_str());
+  auto written = _write(fd, data, (unsigned int)size);
+  _close(fd);
+  if (written < 0 || (size_t)written != size)
+    CapricaReportingContext::logicalFatal("Unable to write to '%s'!", destPath.c_str());
+  if (conf::General::atomicWrite && !MoveFileExA(destPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    CapricaReportingContext::logicalFatal("Unable to replace '%s'!", path.c_str());
+}
+
 }}
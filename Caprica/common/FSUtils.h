@@ -15,4 +15,15 @@ std::string_view parentPathAsRef(std::string_view file);
 
 std::string canonical(const std::string& path);
 
+// Create the directory and any missing parents. Directories known
+// to exist are remembered, so this is cheap to call for every file
+// written into one.
+void createDirectories(const std::string& path);
+// Returns true if the file exists and holds exactly the data, not
+// counting the ignoredSize bytes at ignoredOffset.
+bool fileMatches(const std::string& path, const char* data, size_t size, size_t ignoredOffset = 0, size_t ignoredSize = 0);
+// Replace the contents of the file with the data in a single write,
+// going through a temporary file if conf::General::atomicWrite is set.
+void writeFile(const std::string& path, const char* data, size_t size);
+
 }}
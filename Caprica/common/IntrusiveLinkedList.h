@@ -48,6 +48,19 @@ struct IntrusiveLinkedList final
     return ret;
   }
 
+  // Drops every element after val, which must be in this list.
+  // Returns the number of elements dropped.
+  size_t truncateAfter(T* val) {
+    size_t newSize = 1;
+    for (auto cur = mFront; cur != val; cur = cur->next)
+      newSize++;
+    auto dropped = mSize - newSize;
+    val->next = nullptr;
+    mBack = val;
+    mSize = newSize;
+    return dropped;
+  }
+
   size_t size() const { return mSize; }
 
 private:
@@ -16,7 +16,7 @@ size_t ReffyStringPool::lookup(const identifier_ref& str) {
 identifier_ref ReffyStringPool::byIndex(size_t v) const {
   assert(v < count);
   auto h = strings[v];
-  return identifier_ref((const char*)(h + 1), h->length);
+  return identifier_ref(h->data, h->length);
 }
 
 void ReffyStringPool::push_back(const identifier_ref& str) {
@@ -24,6 +24,14 @@ void ReffyStringPool::push_back(const identifier_ref& str) {
   push_back_with_hash(str, h, find(str, h));
 }
 
+void ReffyStringPool::push_back_ref(const identifier_ref& str) {
+  auto h = hash(str);
+  auto hdr = alloc.make<StringHeader>();
+  hdr->length = (uint16_t)str.size();
+  hdr->data = str.data();
+  push_back_header(hdr, h, find(str, h));
+}
+
 void ReffyStringPool::reset() {
   generationNumber++;
   for (size_t i = 0; i < count; i++)
@@ -48,6 +56,10 @@ size_t ReffyStringPool::push_back_with_hash(const identifier_ref& str, size_t ha
   hdr->length = (uint16_t)str.size();
   hdr->data = (const char*)(hdr + 1);
   memcpy((void*)hdr->data, str.data(), str.size());
+  return push_back_header(hdr, hash, entry);
+}
+
+size_t ReffyStringPool::push_back_header(StringHeader* hdr, size_t hash, HashEntry* entry) {
   auto ret = count;
   count++;
   strings[ret] = hdr;
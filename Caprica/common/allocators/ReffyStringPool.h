@@ -17,6 +17,9 @@ struct ReffyStringPool final
   size_t lookup(const identifier_ref& str);
   identifier_ref byIndex(size_t v) const;
   void push_back(const identifier_ref& str);
+  // Add a string without copying it, so it must outlive
+  // the pool, or at least the next reset.
+  void push_back_ref(const identifier_ref& str);
   void reset();
   size_t size() const { return count; };
 
@@ -42,6 +45,7 @@ private:
 
   HashEntry* find(const identifier_ref& str, size_t hash);
   size_t push_back_with_hash(const identifier_ref& str, size_t hash, HashEntry* entry);
+  size_t push_back_header(StringHeader* hdr, size_t hash, HashEntry* entry);
   static size_t hash(const identifier_ref& str);
 };
 
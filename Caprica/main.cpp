@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <iostream>
 #include <ostream>
 #include <string>
 
@@ -18,6 +19,7 @@
 
 #include <pex/PexAsmWriter.h>
 #include <pex/PexOptimizer.h>
+#include <pex/PexPeepholeOptimizer.h>
 #include <pex/PexReader.h>
 #include <pex/PexWriter.h>
 #include <pex/parser/PexAsmParser.h>
@@ -32,6 +34,39 @@ using caprica::papyrus::PapyrusCompilationNode;
 namespace caprica {
 bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManager* jobManager);
 
+static PapyrusCompilationNode::NodeType nodeTypeForExtension(std::string_view ext) {
+  if (pathEq(ext, ".psc"))
+    return PapyrusCompilationNode::NodeType::PapyrusCompile;
+  if (pathEq(ext, ".pas"))
+    return PapyrusCompilationNode::NodeType::PasCompile;
+  if (pathEq(ext, ".pex"))
+    return PapyrusCompilationNode::NodeType::PexDissassembly;
+  return PapyrusCompilationNode::NodeType::Unknown;
+}
+
+static time_t calcLastModTime(FILETIME ft) {
+  ULARGE_INTEGER ull;
+  ull.LowPart = ft.dwLowDateTime;
+  ull.HighPart = ft.dwHighDateTime;
+  return ull.QuadPart / 10000000ULL - 11644473600ULL;
+}
+
+static size_t calcFileSize(DWORD low, DWORD high) {
+  ULARGE_INTEGER ull;
+  ull.LowPart = low;
+  ull.HighPart = high;
+  return ull.QuadPart;
+}
+
+// Only Papyrus scripts can be referred to by other scripts, so
+// everything else is compiled on its own.
+static void pushNode(PapyrusCompilationNode* node, caprica::caseless_unordered_identifier_ref_map<PapyrusCompilationNode*>& namespaceMap) {
+  if (node->getType() == PapyrusCompilationNode::NodeType::PapyrusCompile)
+    namespaceMap.emplace(caprica::identifier_ref(node->baseName), node);
+  else
+    caprica::papyrus::PapyrusCompilationContext::pushStandaloneNode(node);
+}
+
 bool addFilesFromDirectory(const std::string& f, bool recursive, const std::string& baseOutputDir, caprica::CapricaJobManager* jobManager) {
   // Blargle flargle.... Using the raw Windows API is 5x
   // faster than boost::filesystem::recursive_directory_iterator,
@@ -71,14 +106,8 @@ bool addFilesFromDirectory(const std::string& f, bool recursive, const std::stri
               dirs.push_back(curDir + "\\" + data.cFileName);
           }
         } else {
-          auto ext = FSUtils::extensionAsRef(filenameRef);
-          if (pathEq(ext, ".psc")) {
-            const auto calcLastModTime = [](FILETIME ft) -> time_t {
-              ULARGE_INTEGER ull;
-              ull.LowPart = ft.dwLowDateTime;
-              ull.HighPart = ft.dwHighDateTime;
-              return ull.QuadPart / 10000000ULL - 11644473600ULL;
-            };
+          auto type = nodeTypeForExtension(FSUtils::extensionAsRef(filenameRef));
+          if (type == PapyrusCompilationNode::NodeType::PapyrusCompile || (type != PapyrusCompilationNode::NodeType::Unknown && conf::General::includeAsmFiles)) {
             std::string sourceFilePath = curDirFull + "\\" + data.cFileName;
             std::string filenameToDisplay;
             std::string outputDir;
@@ -92,19 +121,14 @@ bool addFilesFromDirectory(const std::string& f, bool recursive, const std::stri
             caprica::CapricaStats::inputFileCount++;
             auto node = new PapyrusCompilationNode(
               jobManager,
-              PapyrusCompilationNode::NodeType::PapyrusCompile,
+              type,
               std::move(filenameToDisplay),
               std::move(outputDir),
               std::move(sourceFilePath),
               calcLastModTime(data.ftLastWriteTime),
-              [](DWORD low, DWORD high) {
-                ULARGE_INTEGER ull;
-                ull.LowPart = low;
-                ull.HighPart = high;
-                return ull.QuadPart;
-              }(data.nFileSizeLow, data.nFileSizeHigh)
+              calcFileSize(data.nFileSizeLow, data.nFileSizeHigh)
             );
-            namespaceMap.emplace(caprica::identifier_ref(node->baseName), node);
+            pushNode(node, namespaceMap);
           }
         }
       }
@@ -119,6 +143,31 @@ bool addFilesFromDirectory(const std::string& f, bool recursive, const std::stri
   return true;
 }
 
+bool addSingleFile(const std::string& f, const std::string& baseOutputDir, caprica::CapricaJobManager* jobManager) {
+  auto absPath = caprica::FSUtils::canonical(f);
+  WIN32_FILE_ATTRIBUTE_DATA data;
+  if (!GetFileAttributesExA(absPath.c_str(), GetFileExInfoStandard, &data)) {
+    std::cout << "An error occured while trying to read the attributes of '" << absPath << "'!" << std::endl;
+    return false;
+  }
+
+  caprica::CapricaStats::inputFileCount++;
+  auto node = new PapyrusCompilationNode(
+    jobManager,
+    nodeTypeForExtension(FSUtils::extensionAsRef(f)),
+    std::string(f),
+    std::string(baseOutputDir),
+    std::move(absPath),
+    calcLastModTime(data.ftLastWriteTime),
+    calcFileSize(data.nFileSizeLow, data.nFileSizeHigh)
+  );
+  caprica::caseless_unordered_identifier_ref_map<PapyrusCompilationNode*> namespaceMap{ };
+  pushNode(node, namespaceMap);
+  if (namespaceMap.size())
+    caprica::papyrus::PapyrusCompilationContext::pushNamespaceFullContents("", std::move(namespaceMap));
+  return true;
+}
+
 void parseUserFlags(std::string&& flagsPath) {
   caprica::CapricaReportingContext reportingContext{ flagsPath };
   auto parser = new caprica::parser::CapricaUserFlagsParser(reportingContext, flagsPath);
@@ -137,6 +186,8 @@ int main(int argc, char* argv[])
     caprica::CapricaReportingContext::breakIfDebugging();
     return -1;
   }
+  if (conf::General::extractArchive != "" || conf::General::diffDirectory != "")
+    return 0;
   auto endParse = std::chrono::high_resolution_clock::now();
   if (conf::Performance::dumpTiming)
     std::cout << "Parse: " << std::chrono::duration_cast<std::chrono::milliseconds>(endParse - startParse).count() << "ms" << std::endl;
@@ -158,6 +209,8 @@ int main(int argc, char* argv[])
       std::cout << "Compiled " << "N/A" /*caprica::CapricaStats::inputFileCount*/ << " files in " << compTime << "ms" << std::endl;
       caprica::CapricaStats::outputStats();
     }
+    if (conf::Debug::dumpOptimizationStats)
+      caprica::pex::PexPeepholeOptimizer::outputStats();
   } catch (const std::runtime_error& ex) {
     if (ex.what() != std::string(""))
       std::cout << ex.what() << std::endl;
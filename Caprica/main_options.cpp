@@ -1,9 +1,13 @@
 
 #include <boost/program_options.hpp>
 
+#include <common/CapricaArchive.h>
 #include <common/CapricaConfig.h>
+#include <common/CapricaProfile.h>
 #include <common/FSUtils.h>
 
+#include <pex/PexDiff.h>
+
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -18,6 +22,7 @@ namespace caprica {
 struct CapricaJobManager;
 
 bool addFilesFromDirectory(const std::string& f, bool recursive, const std::string& baseOutputDir, caprica::CapricaJobManager* jobManager);
+bool addSingleFile(const std::string& f, const std::string& baseOutputDir, caprica::CapricaJobManager* jobManager);
 void parseUserFlags(std::string&& flagsPath);
 
 static std::pair<std::string, std::string> parseOddArguments(const std::string& str) {
@@ -40,10 +45,14 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       ("help,h", "Print usage information.")
       ("import,i", po::value<std::vector<std::string>>()->composing(), "Set the compiler's import directories.")
       ("flags,f", po::value<std::string>(), "Set the file defining the user flags.")
-      ("optimize,O", po::bool_switch(&conf::CodeGeneration::enableOptimizations)->default_value(false), "Enable optimizations.")
+      ("optimize,O", po::value<size_t>(&conf::CodeGeneration::optimizationLevel)->default_value(0)->implicit_value(1), "Enable optimizations. Pass -O2 to also enable copy propagation, common subexpression elimination, dead store elimination, and loop invariant hoisting.")
       ("output,o", po::value<std::string>()->default_value(filesystem::current_path().string()), "Set the directory to save compiler output to.")
+      ("output-archive", po::value<std::string>(&conf::General::outputArchive)->default_value(""), "Write the compiled files into a single archive at this path, rather than as loose files in the output directory.")
+      ("extract-archive", po::value<std::string>(&conf::General::extractArchive)->default_value(""), "Extract the files in an archive written by --output-archive to the output directory, then exit without compiling anything.")
+      ("diff", po::value<std::string>(&conf::General::diffDirectory)->default_value(""), "Compare the Pex files in the directory passed against those in this directory, ignoring their timestamps, and print what changed in each, then exit without compiling anything.")
       ("parallel-compile,p", po::bool_switch(&conf::General::compileInParallel)->default_value(false), "Compile files in parallel.")
       ("recurse,r", po::bool_switch(&iterateCompiledDirectoriesRecursively)->default_value(false), "Recursively compile all scripts in the directories passed.")
+      ("include-asm", po::bool_switch(&conf::General::includeAsmFiles)->default_value(false), "Also disassemble the Pex files (*.pex), and assemble the Pex assembly files (*.pas), in the directories passed.")
       ("release", po::bool_switch(&conf::CodeGeneration::disableDebugCode)->default_value(false), "Don't generate DebugOnly code.")
       ("final", po::bool_switch(&conf::CodeGeneration::disableBetaCode)->default_value(false), "Don't generate BetaOnly code.")
       ("all-warnings-as-errors", po::bool_switch(&conf::Warnings::treatWarningsAsErrors)->default_value(false), "Treat all warnings as if they were errors.")
@@ -66,11 +75,21 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       ("allow-negative-literal-as-binary-op", po::value<bool>(&conf::Papyrus::allowNegativeLiteralAsBinaryOp)->default_value(true), "Allow a negative literal number to be parsed as a binary op.")
       ("async-read", po::value<bool>(&conf::Performance::asyncFileRead)->default_value(true), "Allow async file reading. This is primarily useful on SSDs.")
       ("async-write", po::value<bool>(&conf::Performance::asyncFileWrite)->default_value(true), "Allow writing output to disk on background threads.")
+      ("atomic-write", po::value<bool>(&conf::General::atomicWrite)->default_value(false), "Write each output file to a temporary file, then rename it into place, so that an interrupted compile never leaves a partially written file.")
+      ("batched-read", po::value<bool>(&conf::Performance::batchedFileRead)->default_value(false), "With async reading, read many files at a time with overlapped I/O, parsing each as soon as it has been read.")
+      ("debug-line-sidecar", po::bool_switch(&conf::CodeGeneration::debugLineMapSidecar)->default_value(false), "Write the line numbers from the debug info to a compact .pexlines file next to each Pex file, rather than into it. The Pex file keeps its property groups and struct orders, so they still show up in the Creation Kit. Line numbers are restored from the .pexlines file when Caprica disassembles the Pex file.")
       ("dump-asm", po::bool_switch(&conf::Debug::dumpPexAsm)->default_value(false), "Dump the PEX assembly code for the input files.")
       ("enable-ck-optimizations", po::value<bool>(&conf::CodeGeneration::enableCKOptimizations)->default_value(true), "Enable optimizations that the CK compiler normally does regardless of the -optimize switch.")
       ("enable-debug-info", po::value<bool>(&conf::CodeGeneration::emitDebugInfo)->default_value(true), "Enable the generation of debug info. Disabling this will result in Property Groups not showing up in the Creation Kit for the compiled script. This also removes the line number and struct order information.")
       ("enable-language-extensions", po::value<bool>(&conf::Papyrus::enableLanguageExtensions)->default_value(true), "Enable Caprica's extensions to the Papyrus language.")
+      ("enable-loop-hoisting", po::value<bool>(&conf::CodeGeneration::enableLoopInvariantHoisting)->default_value(true), "Allow -O2 to move array lengths and auto property reads that can't change out of loops.")
+      ("inline-threshold", po::value<size_t>(&conf::CodeGeneration::inlineThreshold)->default_value(10), "With optimizations enabled, substitute the body of non-native Global functions of at most this many instructions for calls to them. Functions with a user flag named NoInline are never inlined. 0 disables inlining.")
+      ("profile-hot-call-count", po::value<size_t>(&conf::CodeGeneration::profileHotCallCount)->default_value(100), "The number of calls in the profile passed to --profile-use at which a function is considered hot.")
+      ("profile-use", po::value<std::string>(&conf::CodeGeneration::profileUseFile)->default_value(""), "Use a profiling log of call counts per function, one 'Object.State.Function Count' per line, to spend the expensive optimizations on hot functions and keep cold functions compact.")
       ("resolve-symlinks", po::value<bool>(&conf::Performance::resolveSymlinks)->default_value(false), "Fully resolve symlinks when determining file paths.")
+      ("skip-unchanged", po::bool_switch(&conf::General::skipUnchangedOutput)->default_value(false), "Don't rewrite output files whose contents would be identical, so that their modification times are kept.")
+      ("skip-unchanged-ignore-time", po::bool_switch(&conf::General::skipUnchangedIgnoreTime)->default_value(false), "With --skip-unchanged, treat output files that differ only in their compilation time as unchanged.")
+      ("whole-program-analysis", po::bool_switch(&conf::General::wholeProgramAnalysis)->default_value(false), "Once everything is compiled, warn about functions and properties that none of the compiled scripts use.")
       ;
 
     po::options_description hiddenDesc("");
@@ -81,6 +100,9 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       ("debug-control-flow-graph", po::value<bool>(&conf::Debug::debugControlFlowGraph)->default_value(false), "Dump the control flow graph for every function to std::cout.")
       ("performance-test-mode", po::bool_switch(&conf::Performance::performanceTestMode)->default_value(false), "Enable performance test mode.")
       ("dump-timing", po::bool_switch(&conf::Performance::dumpTiming)->default_value(false), "Dump timing info.")
+      ("dump-optimization-stats", po::bool_switch(&conf::Debug::dumpOptimizationStats)->default_value(false), "Dump the number of instructions removed by the optimizer for each file, and by each peephole pattern.")
+      ("benchmark-pex-writer", po::value<size_t>(&conf::Debug::benchmarkPexWriterIterations)->default_value(0), "Write every compiled file this many extra times, with and without sizing the output buffer up front, and report how long it took.")
+      ("optimization-remarks", po::value<std::string>(&conf::Debug::optimizationRemarksFile)->default_value(""), "Write a line of JSON to this file for every change an optimization pass makes to a function.")
       ;
 
     po::options_description engineLimitsDesc("");
@@ -135,10 +157,10 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       return false;
     }
 
-    if (vm.count("help") || !vm.count("input-file")) {
+    if (vm.count("help") || (!vm.count("input-file") && conf::General::extractArchive == "")) {
       std::cout << "Caprica Papyrus Compiler v0.2.0" << std::endl;
       std::cout << "Usage: Caprica <sourceFile / directory>" << std::endl;
-      std::cout << "Note that when passing a directory, only Papyrus script files (*.psc) in it will be compiled. Pex (*.pex) and Pex assembly (*.pas) files will be ignored." << std::endl;
+      std::cout << "Note that when passing a directory, only Papyrus script files (*.psc) in it will be compiled. Pex (*.pex) and Pex assembly (*.pas) files will be ignored unless --include-asm is passed." << std::endl;
       std::cout << visibleDesc << std::endl;
       return false;
     }
@@ -148,6 +170,8 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       conf::Papyrus::allowDecompiledStructNameRefs = true;
     }
 
+    conf::CodeGeneration::enableOptimizations = conf::CodeGeneration::optimizationLevel > 0;
+
     if (vm["performance-test-mode"].as<bool>()) {
       conf::Performance::dumpTiming = true;
       conf::Performance::asyncFileRead = true;
@@ -195,6 +219,18 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       filesystem::create_directories(baseOutputDir);
     baseOutputDir = FSUtils::canonical(baseOutputDir);
 
+    if (conf::General::extractArchive != "")
+      return CapricaArchive::extract(conf::General::extractArchive, baseOutputDir);
+
+    if (conf::General::diffDirectory != "") {
+      auto dirs = vm["input-file"].as<std::vector<std::string>>();
+      if (dirs.size() != 1) {
+        std::cout << "Expected a single directory to compare against '" << conf::General::diffDirectory << "'!" << std::endl;
+        return false;
+      }
+      return pex::PexDiff::diffDirectories(jobManager, conf::General::diffDirectory, dirs[0]);
+    }
+
     if (vm.count("flags")) {
       const auto findFlags = [progamBasePath, baseOutputDir](const std::string& flagsPath) -> std::string {
         if (filesystem::exists(flagsPath))
@@ -222,6 +258,12 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
       parseUserFlags(std::move(flagsPath));
     }
 
+    if (conf::CodeGeneration::profileUseFile != "" && !CapricaProfile::load(conf::CodeGeneration::profileUseFile))
+      return false;
+
+    if (conf::General::outputArchive != "" && !conf::Performance::performanceTestMode)
+      CapricaArchive::openWriter(conf::General::outputArchive, baseOutputDir);
+
 
     auto filesPassed = vm["input-file"].as<std::vector<std::string>>();
     for (auto& f : filesPassed) {
@@ -239,10 +281,8 @@ bool parseCommandLineArguments(int argc, char* argv[], caprica::CapricaJobManage
           std::cout << "Expected either a Papyrus file (*.psc), Pex assembly file (*.pas), or a Pex file (*.pex)!" << std::endl;
           return false;
         }
-        auto canon = FSUtils::canonical(f);
-        auto oDir = baseOutputDir;
-        // TODO: Implement correctly.
-        //filesToCompile.push_back(ScriptToCompile(std::move(f), std::move(oDir), std::move(canon), boost::filesystem::last_write_time(f), 0));
+        if (!addSingleFile(f, baseOutputDir, jobManager))
+          return false;
       }
     }
   } catch (const std::exception& ex) {
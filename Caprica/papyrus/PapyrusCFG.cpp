@@ -78,8 +78,11 @@ void PapyrusControlFlowNode::dumpNode(int currentDepth) {
 bool PapyrusCFG::processStatements(const IntrusiveLinkedList<statements::PapyrusStatement>& stmts) {
   bool wasTerminal = false;
   for (auto s : stmts) {
+    auto fallthroughsBefore = possibleFallthroughCount;
     if (s->buildCFG(*this)) {
       wasTerminal = true;
+      if (s != stmts.back() && fallthroughsBefore == possibleFallthroughCount)
+        unreachableTails.push_back(std::make_pair(&stmts, s));
       break;
     }
   }
@@ -88,4 +91,16 @@ bool PapyrusCFG::processStatements(const IntrusiveLinkedList<statements::Papyrus
   return wasTerminal;
 }
 
+size_t PapyrusCFG::removeUnreachableStatements() {
+  // The graph is built from const statements, but the lists belong
+  // to the function that owns this graph, which is free to modify them.
+  size_t removed = 0;
+  for (auto& t : unreachableTails) {
+    auto stmts = const_cast<IntrusiveLinkedList<statements::PapyrusStatement>*>(t.first);
+    removed += stmts->truncateAfter(const_cast<statements::PapyrusStatement*>(t.second));
+  }
+  unreachableTails.clear();
+  return removed;
+}
+
 }}
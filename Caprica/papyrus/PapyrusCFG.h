@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stack>
+#include <utility>
+#include <vector>
 
 #include <common/allocators/ChainedPool.h>
 #include <common/CapricaReportingContext.h>
@@ -61,10 +63,14 @@ struct PapyrusCFG final
     addLeaf();
     bool wasTerminal = processStatements(stmts);
     bool isTerminal = !popBreakTerminal() && wasTerminal;
-    if (isTerminal)
+    if (isTerminal) {
+      // The condition may be false before the body is ever run,
+      // or a continue may reach a false condition.
+      markPossibleFallthrough();
       terminateNode(PapyrusControlFlowNodeEdgeType::Children);
-    else
+    } else {
       createSibling();
+    }
     return isTerminal;
   }
 
@@ -72,6 +78,17 @@ struct PapyrusCFG final
     // We don't do anything here currently.
   }
 
+  // A statement is treated as terminal for the purposes of the
+  // return value check, but control can still reach whatever comes
+  // after it, so the statements following it must not be removed.
+  void markPossibleFallthrough() {
+    possibleFallthroughCount++;
+  }
+
+  // Remove the statements that follow a terminal statement in
+  // the same block. Returns the number of statements removed.
+  size_t removeUnreachableStatements();
+
   void terminateNode(PapyrusControlFlowNodeEdgeType tp) {
     nodeStack.top()->edgeType = tp;
     nodeStack.pop();
@@ -120,6 +137,10 @@ private:
 
   allocators::ChainedPool alloc{ 4 * 1024 };
   int nextNodeID{ 0 };
+  size_t possibleFallthroughCount{ 0 };
+  // The last reachable statement of each block that has
+  // unreachable statements after it.
+  std::vector<std::pair<const IntrusiveLinkedList<statements::PapyrusStatement>*, const statements::PapyrusStatement*>> unreachableTails{ };
   IntrusiveStack<PapyrusControlFlowNode> nodeStack{ };
   IntrusiveStack<BreakTarget> breakTargetStack{ };
 };
@@ -2,15 +2,31 @@
 
 #include <io.h>
 #include <fcntl.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
-
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <common/CapricaArchive.h>
+#include <common/CapricaBatchedReader.h>
 #include <common/CapricaConfig.h>
+#include <common/CapricaWriteQueue.h>
 #include <common/allocators/AtomicChainedPool.h>
 
+#include <papyrus/PapyrusInliner.h>
 #include <papyrus/parser/PapyrusParser.h>
 
+#include <pex/PexDebugLineMap.h>
 #include <pex/PexOptimizer.h>
+#include <pex/PexPeepholeOptimizer.h>
 #include <pex/PexReflector.h>
 #include <pex/parser/PexAsmParser.h>
 
@@ -30,6 +46,13 @@ PapyrusObject* PapyrusCompilationNode::awaitSemantic() {
   return resolvedObject;
 }
 
+PapyrusObject* PapyrusCompilationNode::awaitSemantic2() {
+  if (type != NodeType::PapyrusCompile)
+    return nullptr;
+  semantic2Job.await();
+  return resolvedObject;
+}
+
 void PapyrusCompilationNode::queueCompile() {
   jobManager->queueJob(&writeJob);
 }
@@ -38,12 +61,67 @@ void PapyrusCompilationNode::awaitWrite() {
   writeJob.await();
 }
 
+void PapyrusCompilationNode::reportUnreferencedMembers() {
+  if (type != NodeType::PapyrusCompile)
+    return;
+  resolvedObject->reportUnreferencedMembers(reportingContext);
+  reportingContext.exitIfErrors();
+}
+
 allocators::AtomicChainedPool readAllocator{ 1024 * 1024 * 4 };
+
+bool PapyrusCompilationNode::tryMakeBatchedReadRequest(std::vector<CapricaBatchedReader::Request>& requests) {
+  if (filesize == 0 || filesize >= std::numeric_limits<uint32_t>::max())
+    return false;
+
+  CapricaBatchedReader::Request req{ };
+  req.path = sourceFilePath;
+  req.size = filesize;
+  // One byte to detect the file growing, and one for the terminator.
+  req.buffer = readAllocator.allocate(filesize + 2);
+  auto buf = req.buffer;
+  batchedReadState = BatchedReadState::Pending;
+  req.onComplete = [this, buf](bool succeeded) {
+    {
+      std::unique_lock<std::mutex> lock{ batchedReadMutex };
+      if (succeeded) {
+        buf[filesize] = '\0';
+        batchedReadData = std::string_view(buf, filesize);
+        batchedReadState = BatchedReadState::Succeeded;
+      } else {
+        batchedReadState = BatchedReadState::Failed;
+      }
+    }
+    batchedReadCondition.notify_all();
+    // Leave it to a worker to read the normal way.
+    if (!succeeded)
+      jobManager->queueJob(&readJob);
+    if (type == NodeType::PapyrusCompile || type == NodeType::PasCompile || type == NodeType::PexDissassembly)
+      jobManager->queueJob(&parseJob);
+  };
+  requests.push_back(std::move(req));
+  return true;
+}
+
+// Held for every read when they aren't done in parallel, as
+// a HDD has to seek between reads of different files.
+static std::mutex sequentialReadMutex{ };
 void PapyrusCompilationNode::FileReadJob::run() {
   if (parent->type == NodeType::PapyrusCompile || parent->type == NodeType::PasCompile || parent->type == NodeType::PexDissassembly) {
     if (!conf::General::quietCompile)
       std::cout << "Compiling " << parent->reportedName << std::endl;
   }
+  if (parent->batchedReadState != BatchedReadState::None) {
+    std::unique_lock<std::mutex> lock{ parent->batchedReadMutex };
+    parent->batchedReadCondition.wait(lock, [this]() { return parent->batchedReadState != BatchedReadState::Pending; });
+    if (parent->batchedReadState == BatchedReadState::Succeeded) {
+      parent->readFileData = parent->batchedReadData;
+      return;
+    }
+  }
+  std::unique_lock<std::mutex> readLock{ sequentialReadMutex, std::defer_lock };
+  if (!conf::Performance::asyncFileRead)
+    readLock.lock();
   if (parent->filesize < std::numeric_limits<uint32_t>::max()) {
     auto buf = readAllocator.allocate(parent->filesize + 1);
     auto fd = _open(parent->sourceFilePath.c_str(), _O_BINARY | _O_RDONLY | _O_SEQUENTIAL);
@@ -82,6 +160,19 @@ void PapyrusCompilationNode::FileReadJob::run() {
   }
 }
 
+// Restore the line maps split out of a Pex file, if it has them.
+static void readLineMapSidecar(pex::PexFile* file, const std::string& pexPath) {
+  auto path = pexPath.substr(0, pexPath.rfind('.')) + pex::PexDebugLineMap::extension;
+  std::ifstream strm{ path, std::ifstream::binary };
+  if (!strm.is_open())
+    return;
+  std::stringstream contents{ };
+  contents << strm.rdbuf();
+  auto data = contents.str();
+  if (!pex::PexDebugLineMap::read(file, data))
+    std::cout << "Ignoring the line map '" << path << "', as it's invalid or wasn't written for the same compilation of '" << pexPath << "'." << std::endl;
+}
+
 void PapyrusCompilationNode::FileParseJob::run() {
   parent->readJob.await();
   bool isPexFile = false;
@@ -92,9 +183,16 @@ void PapyrusCompilationNode::FileParseJob::run() {
     parent->reportingContext.exitIfErrors();
     delete parser;
   } else if (pathEq(ext, ".pex")) {
-    pex::PexReader rdr(parent->sourceFilePath);
+    pex::PexReader rdr(parent->readFileData);
     auto alloc = new allocators::ChainedPool(1024 * 4);
-    parent->pexFile = pex::PexFile::read(alloc, rdr);
+    try {
+      parent->pexFile = pex::PexFile::read(alloc, rdr);
+    } catch (const CapricaBinaryReader::UnexpectedEndOfData&) {
+      delete alloc;
+      parent->reportingContext.fatal(CapricaFileLocation{ parent->readFileData.size() }, "Unexpected end of file! The file is truncated or isn't a valid Pex file.");
+    }
+    if (!parent->pexFile->debugInfo || !parent->pexFile->debugInfo->functions.size())
+      readLineMapSidecar(parent->pexFile, parent->sourceFilePath);
     isPexFile = true;
     if (parent->type == NodeType::PexDissassembly)
       return;
@@ -134,36 +232,110 @@ void PapyrusCompilationNode::FileParseJob::run() {
 
 void PapyrusCompilationNode::FileSemanticJob::run() {
   parent->parseJob.await();
+  if (parent->type == NodeType::PasCompile || parent->type == NodeType::PexDissassembly)
+    return;
   parent->loadedScript->semantic(parent->resolutionContext);
   parent->reportingContext.exitIfErrors();
 }
 
+// This is separate from the compile job so that codegen can
+// wait for the bodies of functions in other objects to be
+// resolved, which doesn't depend on anything being compiled.
+void PapyrusCompilationNode::FileSemantic2Job::run() {
+  parent->semanticJob.await();
+  if (parent->type != NodeType::PapyrusCompile)
+    return;
+  parent->loadedScript->semantic2(parent->resolutionContext);
+  parent->reportingContext.exitIfErrors();
+  delete parent->resolutionContext;
+  parent->resolutionContext = nullptr;
+}
+
 static constexpr bool disablePexBuild = false;
 
+static std::atomic<size_t> benchmarkedFileCount{ 0 };
+static std::atomic<size_t> benchmarkedBytes{ 0 };
+static std::atomic<long long> benchmarkPresizedNanoseconds{ 0 };
+static std::atomic<long long> benchmarkGrowingNanoseconds{ 0 };
+
+// Write the file repeatedly both with and without sizing the
+// buffer first, to measure what the sizing is worth.
+static void benchmarkPexWriter(const pex::PexFile* file) {
+  const auto timeWrites = [file](bool presize) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < conf::Debug::benchmarkPexWriterIterations; i++) {
+      pex::PexWriter wtr{ };
+      if (presize)
+        wtr.reserve(file->writeSize());
+      file->write(wtr);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  };
+  benchmarkGrowingNanoseconds += timeWrites(false);
+  benchmarkPresizedNanoseconds += timeWrites(true);
+  benchmarkedBytes += file->writeSize() * conf::Debug::benchmarkPexWriterIterations;
+  benchmarkedFileCount++;
+}
+
+static void outputPexWriterBenchmark() {
+  const auto nsPerByte = [](long long ns) {
+    return benchmarkedBytes ? (double)ns / (double)benchmarkedBytes : 0.0;
+  };
+  std::cout << "PexWriter benchmark: " << benchmarkedFileCount << " files, " << conf::Debug::benchmarkPexWriterIterations << " iterations, " << benchmarkedBytes << " bytes." << std::endl;
+  std::cout << "  Presized: " << (benchmarkPresizedNanoseconds / 1000000) << "ms, " << nsPerByte(benchmarkPresizedNanoseconds) << "ns/byte" << std::endl;
+  std::cout << "  Growing:  " << (benchmarkGrowingNanoseconds / 1000000) << "ms, " << nsPerByte(benchmarkGrowingNanoseconds) << "ns/byte" << std::endl;
+}
+
+static pex::PexWriter* writePexFile(pex::PexFile* file, CapricaBinaryWriter** lineMapWriter) {
+  // The line maps are left out of the file itself, but are put
+  // back afterwards for anything that still wants them.
+  IntrusiveLinkedList<pex::PexDebugFunctionInfo> lineMaps{ };
+  bool splitLineMaps = conf::CodeGeneration::debugLineMapSidecar && file->debugInfo;
+  if (splitLineMaps) {
+    *lineMapWriter = new CapricaBinaryWriter();
+    pex::PexDebugLineMap::write(file, **lineMapWriter);
+    std::swap(lineMaps, file->debugInfo->functions);
+  }
+
+  if (conf::Debug::benchmarkPexWriterIterations)
+    benchmarkPexWriter(file);
+
+  auto wtr = new pex::PexWriter();
+  auto size = file->writeSize();
+  wtr->reserve(size);
+  file->write(*wtr);
+  assert(wtr->writtenBytes() == size);
+  if (splitLineMaps)
+    std::swap(lineMaps, file->debugInfo->functions);
+  return wtr;
+}
+
+static void optimizePexFile(pex::PexFile* file, const std::string& reportedName) {
+  auto stats = pex::PexOptimizer::optimize(file);
+  stats.instructionsAfter -= pex::PexPeepholeOptimizer::optimize(file);
+  if (conf::Debug::dumpOptimizationStats) {
+    std::cout << "Optimized " << reportedName << ": " << stats.instructionsBefore << " -> " << stats.instructionsAfter
+              << " instructions (" << (stats.instructionsBefore - stats.instructionsAfter) << " removed)" << std::endl;
+  }
+}
+
 void PapyrusCompilationNode::FileCompileJob::run() {
-  parent->semanticJob.await();
+  parent->semantic2Job.await();
   switch (parent->type) {
     case NodeType::PapyrusCompile: {
-      parent->loadedScript->semantic2(parent->resolutionContext);
-      parent->reportingContext.exitIfErrors();
-      delete parent->resolutionContext;
-      parent->resolutionContext = nullptr;
-
       if (!disablePexBuild) {
         parent->pexFile = parent->loadedScript->buildPex(parent->reportingContext);
         parent->reportingContext.exitIfErrors();
 
         if (conf::CodeGeneration::enableOptimizations)
-          pex::PexOptimizer::optimize(parent->pexFile);
+          optimizePexFile(parent->pexFile, parent->reportedName);
 
-        parent->pexWriter = new pex::PexWriter();
-        parent->pexFile->write(*parent->pexWriter);
+        parent->pexWriter = writePexFile(parent->pexFile, &parent->lineMapWriter);
 
         if (conf::Debug::dumpPexAsm) {
-          std::ofstream asmStrm(parent->outputDirectory + "\\" + std::string(parent->baseName) + ".pas", std::ofstream::binary);
-          asmStrm.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-          pex::PexAsmWriter asmWtr(asmStrm);
-          parent->pexFile->writeAsm(asmWtr);
+          parent->asmWriter = new pex::PexAsmWriter();
+          parent->pexFile->writeAsm(*parent->asmWriter);
         }
 
         delete parent->pexFile->alloc;
@@ -172,20 +344,17 @@ void PapyrusCompilationNode::FileCompileJob::run() {
       return;
     }
     case NodeType::PexDissassembly: {
-      std::ofstream asmStrm(parent->outputDirectory + "\\" + std::string(parent->baseName) + ".pas", std::ofstream::binary);
-      asmStrm.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-      caprica::pex::PexAsmWriter asmWtr(asmStrm);
-      parent->pexFile->writeAsm(asmWtr);
+      parent->asmWriter = new pex::PexAsmWriter();
+      parent->pexFile->writeAsm(*parent->asmWriter);
       delete parent->pexFile->alloc;
       parent->pexFile = nullptr;
       return;
     }
     case NodeType::PasCompile: {
       if (conf::CodeGeneration::enableOptimizations)
-        pex::PexOptimizer::optimize(parent->pexFile);
+        optimizePexFile(parent->pexFile, parent->reportedName);
 
-      parent->pexWriter = new pex::PexWriter();
-      parent->pexFile->write(*parent->pexWriter);
+      parent->pexWriter = writePexFile(parent->pexFile, &parent->lineMapWriter);
       delete parent->pexFile->alloc;
       parent->pexFile = nullptr;
       return;
@@ -198,28 +367,109 @@ void PapyrusCompilationNode::FileCompileJob::run() {
   CapricaReportingContext::logicalFatal("You shouldn't be trying to compile this!");
 }
 
+static std::atomic<size_t> skippedWriteCount{ 0 };
+
+// In both Pex files and line maps, the compilation time follows
+// 8 bytes of magic number and version.
+static constexpr size_t compilationTimeOffset = 8;
+
+// ignoredSize is the size of the compilation time to ignore when
+// checking if the file is unchanged, or 0 if the file has none.
+static bool outputMatches(const std::string& destPath, const char* data, size_t totalSize, size_t ignoredSize) {
+  return conf::General::outputArchive == "" && conf::General::skipUnchangedOutput &&
+         FSUtils::fileMatches(destPath, data, totalSize, compilationTimeOffset, conf::General::skipUnchangedIgnoreTime ? ignoredSize : 0);
+}
+
+static bool outputMatches(const std::string& destPath, const CapricaBinaryWriter* writer) {
+  bool matches = false;
+  // The writer is sized up front, so this is always a single buffer.
+  writer->applyToBuffers([&](const char* buf, size_t size) {
+    matches = outputMatches(destPath, buf, size, sizeof(time_t));
+  });
+  return matches;
+}
+
+static void writeOutputFile(const std::string& destPath, const char* data, size_t totalSize) {
+  if (conf::General::outputArchive != "") {
+    // The archive writer needs a copy of its own.
+    std::unique_ptr<char[]> copy{ new char[totalSize] };
+    memcpy(copy.get(), data, totalSize);
+    CapricaArchive::append(destPath, std::move(copy), totalSize);
+  } else {
+    FSUtils::writeFile(destPath, data, totalSize);
+  }
+}
+
+static void writeOutputFile(const std::string& destPath, const CapricaBinaryWriter* writer) {
+  writer->applyToBuffers([&](const char* buf, size_t size) {
+    writeOutputFile(destPath, buf, size);
+  });
+}
+
+void PapyrusCompilationNode::writeOutput(pex::PexWriter* writer, CapricaBinaryWriter* lineMapWriter, pex::PexAsmWriter* asmWriter) {
+  auto startWrite = std::chrono::high_resolution_clock::now();
+  auto basePath = outputDirectory + "\\" + std::string(FSUtils::basenameAsRef(sourceFilePath));
+  if (conf::General::outputArchive == "")
+    FSUtils::createDirectories(outputDirectory);
+  // A line map is only used with a Pex file that has the same
+  // compilation time, so the two are skipped or written together.
+  // Otherwise ignoring the time could leave them mismatched.
+  auto pexPath = basePath + ".pex";
+  auto lineMapPath = basePath + pex::PexDebugLineMap::extension;
+  if ((!writer || outputMatches(pexPath, writer)) && (!lineMapWriter || outputMatches(lineMapPath, lineMapWriter))) {
+    skippedWriteCount += (writer ? 1 : 0) + (lineMapWriter ? 1 : 0);
+  } else {
+    if (writer)
+      writeOutputFile(pexPath, writer);
+    if (lineMapWriter)
+      writeOutputFile(lineMapPath, lineMapWriter);
+  }
+  if (asmWriter) {
+    auto& str = asmWriter->str();
+    if (outputMatches(basePath + ".pas", str.data(), str.size(), 0))
+      skippedWriteCount++;
+    else
+      writeOutputFile(basePath + ".pas", str.data(), str.size());
+  }
+
+  if (conf::Performance::dumpTiming) {
+    auto endWrite = std::chrono::high_resolution_clock::now();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(endWrite - startWrite).count();
+    std::cout << ("Write " + reportedName + ": " + std::to_string(us) + "us\n") << std::flush;
+  }
+  delete writer;
+  delete lineMapWriter;
+  delete asmWriter;
+}
+
 void PapyrusCompilationNode::FileWriteJob::run() {
   parent->compileJob.await();
   switch (parent->type) {
     case NodeType::PasCompile:
-    case NodeType::PapyrusCompile: {
-      if (!conf::Performance::performanceTestMode) {
-        auto baseFileName = std::string(FSUtils::basenameAsRef(parent->sourceFilePath));
-        auto containingDir = std::experimental::filesystem::path(parent->outputDirectory);
-        if (!std::experimental::filesystem::exists(containingDir))
-          std::experimental::filesystem::create_directories(containingDir);
-        std::ofstream destFile{ parent->outputDirectory + "\\" + baseFileName + ".pex", std::ifstream::binary };
-        destFile.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-        parent->pexWriter->applyToBuffers([&](const char* data, size_t size) {
-          destFile.write(data, size);
-        });
-      }
-      delete parent->pexWriter;
+    case NodeType::PapyrusCompile:
+    case NodeType::PexDissassembly: {
+      auto writer = parent->pexWriter;
+      auto lineMapWriter = parent->lineMapWriter;
+      auto asmWriter = parent->asmWriter;
       parent->pexWriter = nullptr;
+      parent->lineMapWriter = nullptr;
+      parent->asmWriter = nullptr;
+      if (conf::Performance::performanceTestMode) {
+        delete writer;
+        delete lineMapWriter;
+        delete asmWriter;
+      } else if (conf::Performance::asyncFileWrite) {
+        auto node = parent;
+        auto bytes = (writer ? writer->allocatedBytes() : 0) +
+                     (lineMapWriter ? lineMapWriter->allocatedBytes() : 0) +
+                     (asmWriter ? asmWriter->allocatedBytes() : 0);
+        CapricaWriteQueue::queue(bytes, [node, writer, lineMapWriter, asmWriter]() { node->writeOutput(writer, lineMapWriter, asmWriter); });
+      } else {
+        parent->writeOutput(writer, lineMapWriter, asmWriter);
+      }
       return;
     }
     case NodeType::Unknown:
-    case NodeType::PexDissassembly:
     case NodeType::PasReflection:
     case NodeType::PexReflection:
       break;
@@ -244,6 +494,13 @@ struct PapyrusNamespace final
       c.second->awaitRead();
   }
 
+  void collectNodes(std::vector<PapyrusCompilationNode*>& nodes) {
+    for (auto o : objects)
+      nodes.push_back(o.second);
+    for (auto c : children)
+      c.second->collectNodes(nodes);
+  }
+
   void queueCompile() {
     for (auto o : objects)
       o.second->queueCompile();
@@ -258,9 +515,18 @@ struct PapyrusNamespace final
       c.second->awaitCompile();
   }
 
+  void reportUnreferencedMembers() {
+    for (auto o : objects)
+      o.second->reportUnreferencedMembers();
+    for (auto c : children)
+      c.second->reportUnreferencedMembers();
+  }
+
   void createNamespace(const identifier_ref& curPiece, caseless_unordered_identifier_ref_map<PapyrusCompilationNode*>&& map) {
     if (curPiece == "") {
-      objects = std::move(map);
+      // The same namespace may be pushed more than once, such as
+      // the root for each single file passed.
+      objects.insert(map.begin(), map.end());
       return;
     }
 
@@ -344,18 +610,120 @@ struct PapyrusNamespace final
 }
 
 static PapyrusNamespace rootNamespace{ };
+// The I/O threads writing output, and how much memory the
+// writers waiting on them may hold before compiling stalls.
+static constexpr size_t maxWriteThreads = 2;
+static constexpr size_t maxQueuedWriteBytes = 1024 * 1024 * 64;
 void PapyrusCompilationContext::pushNamespaceFullContents(const std::string& namespaceName, caseless_unordered_identifier_ref_map<PapyrusCompilationNode*>&& map) {
   rootNamespace.createNamespace(namespaceName, std::move(map));
 }
 
+// Pex files being disassembled and Pex assembly files being
+// assembled aren't in a namespace, as they can't be resolved
+// against.
+static std::vector<PapyrusCompilationNode*> standaloneNodes{ };
+void PapyrusCompilationContext::pushStandaloneNode(PapyrusCompilationNode* node) {
+  standaloneNodes.push_back(node);
+}
+
+static void collectNodes(std::vector<PapyrusCompilationNode*>& nodes) {
+  rootNamespace.collectNodes(nodes);
+  nodes.insert(nodes.end(), standaloneNodes.begin(), standaloneNodes.end());
+}
+
+static std::thread readAhead{ };
+static bool readsStarted{ false };
+
+// Reads are normally queued as jobs as the nodes are created, but
+// the other ways of reading need every node to exist first.
+static void startReads() {
+  if (readsStarted)
+    return;
+  readsStarted = true;
+
+  std::vector<PapyrusCompilationNode*> nodes{ };
+  if (!conf::Performance::asyncFileRead) {
+    // With reads not done in parallel, a single thread reads
+    // the files in order ahead of the compile workers.
+    collectNodes(nodes);
+    readAhead = std::thread([nodes = std::move(nodes)]() {
+      for (auto n : nodes)
+        n->awaitRead();
+    });
+  } else if (conf::Performance::batchedFileRead) {
+    collectNodes(nodes);
+    std::vector<CapricaBatchedReader::Request> requests{ };
+    std::vector<PapyrusCompilationNode*> unbatched{ };
+    requests.reserve(nodes.size());
+    for (auto n : nodes) {
+      if (!n->tryMakeBatchedReadRequest(requests))
+        unbatched.push_back(n);
+    }
+    if (!CapricaBatchedReader::start(std::move(requests))) {
+      // Nothing was read, so the read jobs waiting on them have
+      // to read them the normal way.
+      for (auto& r : requests)
+        r.onComplete(false);
+    }
+    for (auto n : unbatched)
+      n->queueRead();
+  }
+}
+
+static void finishReads() {
+  if (readAhead.joinable())
+    readAhead.join();
+  CapricaBatchedReader::join();
+}
+
+// Stops the threads doing the reads and writes when compiling is
+// done, including when it fails with an exception, as destroying
+// them while they're still running would terminate the process.
+struct IOThreadsGuard final
+{
+  bool useWriteQueue{ false };
+
+  ~IOThreadsGuard() {
+    finishReads();
+    if (useWriteQueue)
+      CapricaWriteQueue::shutdown();
+  }
+};
+
 void PapyrusCompilationContext::awaitRead() {
+  startReads();
   rootNamespace.awaitRead();
+  for (auto n : standaloneNodes)
+    n->awaitRead();
 }
 
 void PapyrusCompilationContext::doCompile(CapricaJobManager* jobManager) {
-  rootNamespace.queueCompile();
-  jobManager->setQueueInitialized();
-  jobManager->enjoin();
+  bool useWriteQueue = conf::Performance::asyncFileWrite && !conf::Performance::performanceTestMode;
+  {
+    IOThreadsGuard guard{ useWriteQueue };
+    if (useWriteQueue)
+      CapricaWriteQueue::startup(maxWriteThreads, maxQueuedWriteBytes);
+
+    startReads();
+    rootNamespace.queueCompile();
+    for (auto n : standaloneNodes)
+      n->queueCompile();
+    jobManager->setQueueInitialized();
+    jobManager->enjoin();
+  }
+  PapyrusInliner::releaseBodies();
+  if (conf::General::outputArchive != "" && !conf::Performance::performanceTestMode)
+    CapricaArchive::closeWriter();
+
+  if (conf::Debug::benchmarkPexWriterIterations)
+    outputPexWriterBenchmark();
+  if (conf::General::skipUnchangedOutput && conf::General::outputArchive == "" && !conf::General::quietCompile)
+    std::cout << "Skipped writing " << skippedWriteCount << " unchanged files." << std::endl;
+
+  // Every file has been through semantic2 by now, so all of
+  // the calls and property accesses have been resolved.
+  if (conf::General::wholeProgramAnalysis)
+    rootNamespace.reportUnreferencedMembers();
 }
 
 bool PapyrusCompilationContext::tryFindType(const identifier_ref& baseNamespace, const identifier_ref& typeName, PapyrusCompilationNode** retNode, identifier_ref* retStructName) {
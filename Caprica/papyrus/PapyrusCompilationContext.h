@@ -1,7 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include <common/CapricaBatchedReader.h>
+#include <common/CapricaConfig.h>
 #include <common/CapricaJobManager.h>
 #include <common/CaselessStringComparer.h>
 #include <common/FSUtils.h>
@@ -41,7 +47,9 @@ struct PapyrusCompilationNode final
     jobManager(mgr),
     type(compileType) {
     baseName = FSUtils::basenameAsRef(sourceFilePath);
-    jobManager->queueJob(&readJob);
+    // Otherwise they're read once every node has been created.
+    if (conf::Performance::asyncFileRead && !conf::Performance::batchedFileRead)
+      queueRead();
   }
 
   ~PapyrusCompilationNode() {
@@ -55,11 +63,23 @@ struct PapyrusCompilationNode final
       delete resolutionContext;
   }
 
+  void queueRead() { jobManager->queueJob(&readJob); }
+  // Add a request to read the file to be read in a batch, which
+  // queues the parse once it completes. Returns false if the
+  // file can't be read that way.
+  bool tryMakeBatchedReadRequest(std::vector<CapricaBatchedReader::Request>& requests);
   void awaitRead();
   PapyrusObject* awaitParse();
   PapyrusObject* awaitSemantic();
+  // Wait for the function bodies to be resolved. Returns nullptr
+  // if the object wasn't compiled from Papyrus source, as then
+  // there are no bodies.
+  PapyrusObject* awaitSemantic2();
+  CapricaReportingContext& getReportingContext() { return reportingContext; }
+  NodeType getType() const { return type; }
   void queueCompile();
   void awaitWrite();
+  void reportUnreferencedMembers();
 
 private:
   struct BaseJob : public CapricaJob {
@@ -76,7 +96,22 @@ private:
   std::string sourceFilePath;
   std::string_view readFileData{ };
   std::string ownedReadFileData{ };
+  // The read job waits for a batched read that's still in flight,
+  // rather than reading the file a second time.
+  enum class BatchedReadState
+  {
+    None,
+    Pending,
+    Succeeded,
+    Failed,
+  };
+  BatchedReadState batchedReadState{ BatchedReadState::None };
+  std::mutex batchedReadMutex{ };
+  std::condition_variable batchedReadCondition{ };
+  std::string_view batchedReadData{ };
   pex::PexWriter* pexWriter{ nullptr };
+  CapricaBinaryWriter* lineMapWriter{ nullptr };
+  pex::PexAsmWriter* asmWriter{ nullptr };
   PapyrusScript* loadedScript{ nullptr };
   pex::PexFile* pexFile{ nullptr };
   PapyrusObject* resolvedObject{ nullptr };
@@ -84,6 +119,10 @@ private:
   PapyrusResolutionContext* resolutionContext{ nullptr };
   CapricaJobManager* jobManager;
 
+  // Write the output to disk, then free the writers. Any of them
+  // may be null if there's no such output for this node.
+  void writeOutput(pex::PexWriter* writer, CapricaBinaryWriter* lineMapWriter, pex::PexAsmWriter* asmWriter);
+
   struct FileReadJob final : public BaseJob {
     using BaseJob::BaseJob;
     virtual void run() override;
@@ -97,6 +136,11 @@ private:
     using BaseJob::BaseJob;
     virtual void run() override;
   } semanticJob{ this };
+  struct FileSemantic2Job final : public BaseJob
+  {
+    using BaseJob::BaseJob;
+    virtual void run() override;
+  } semantic2Job{ this };
   struct FileCompileJob final : public BaseJob
   {
     using BaseJob::BaseJob;
@@ -114,6 +158,9 @@ struct PapyrusCompilationContext final
   static void awaitRead();
   static void doCompile(CapricaJobManager* jobManager);
   static void pushNamespaceFullContents(const std::string& namespaceName, caseless_unordered_identifier_ref_map<PapyrusCompilationNode*>&& map);
+  // Add a node that nothing else can refer to, such as a file
+  // being disassembled.
+  static void pushStandaloneNode(PapyrusCompilationNode* node);
   static bool tryFindType(const identifier_ref& baseNamespace, const identifier_ref& typeName, PapyrusCompilationNode** retNode, identifier_ref* retStructName);
 };
 
@@ -2,6 +2,7 @@
 
 #include <unordered_set>
 
+#include <common/CapricaConfig.h>
 #include <common/EngineLimits.h>
 
 #include <papyrus/PapyrusCFG.h>
@@ -57,10 +58,12 @@ pex::PexFunction* PapyrusFunction::buildPex(CapricaReportingContext& repCtx,
   func->userFlags = userFlags.buildPex(file);
   func->isGlobal = isGlobal();
   func->isNative = isNative();
+  func->hotness = hotness;
   for (auto p : parameters)
     p->buildPex(file, obj, func);
 
   pex::PexFunctionBuilder bldr{ repCtx, location, file };
+  bldr.hotness = hotness;
   for (auto s : statements)
     s->buildPex(file, bldr);
   bldr.populateFunction(func, fDebInfo);
@@ -92,6 +95,10 @@ void PapyrusFunction::semantic2(PapyrusResolutionContext* ctx) {
 
   ctx->ensureNamesAreUnique(parameters, "parameter");
 
+  // Property functions aren't named in the profile.
+  if (ctx->state && functionType != PapyrusFunctionType::Getter && functionType != PapyrusFunctionType::Setter)
+    hotness = CapricaProfile::classify(ctx->object->name, ctx->state->name, name);
+
   ctx->function = this;
   ctx->pushLocalVariableScope();
   for (auto s : statements)
@@ -116,6 +123,9 @@ void PapyrusFunction::semantic2(PapyrusResolutionContext* ctx) {
         ctx->reportingContext.error(location, "Not all control paths of '%s' return a value.", name.to_string().c_str());
     }
 
+    if (conf::CodeGeneration::enableOptimizations)
+      cfg.removeUnreachableStatements();
+
     if (conf::Debug::debugControlFlowGraph) {
       //std::cout << "CFG for " << name << ":" << std::endl;
       cfg.dumpGraph();
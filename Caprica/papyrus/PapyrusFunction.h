@@ -1,9 +1,11 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 
 #include <common/CapricaFileLocation.h>
+#include <common/CapricaProfile.h>
 #include <common/CaselessStringComparer.h>
 #include <common/identifier_ref.h>
 #include <common/IntrusiveLinkedList.h>
@@ -49,6 +51,13 @@ struct PapyrusFunction final
 
   CapricaFileLocation location;
 
+  // Set when a call in any of the scripts being compiled resolves to
+  // this function. Files are resolved in parallel, hence the atomic.
+  mutable std::atomic<bool> isCalled{ false };
+  // How often the profile passed to --profile-use says this is called.
+  // Set during semantic2.
+  CapricaProfileHotness hotness{ CapricaProfileHotness::Unknown };
+
   bool isBetaOnly() const;
   bool isDebugOnly() const;
   bool isGlobal() const noexcept { return userFlags.isGlobal; }
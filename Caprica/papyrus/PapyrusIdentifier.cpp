@@ -52,9 +52,12 @@ pex::PexValue PapyrusIdentifier::generateLoad(pex::PexFile* file, pex::PexFuncti
   namespace op = caprica::pex::op;
   switch (type) {
     case PapyrusIdentifierType::Property:
-      if (conf::CodeGeneration::enableCKOptimizations && res.prop->isAuto() && !res.prop->isAutoReadOnly() && !base.tmpVar && file->getStringValue(base.name) == "self") {
+      if (conf::CodeGeneration::enableCKOptimizations && isOwnPropertyOnSelf(file, base) && res.prop->isAuto() && !res.prop->isAutoReadOnly()) {
         // We can only do this for properties on ourselves. (CK does this even on parents)
         return pex::PexValue::Identifier(file->getString(res.prop->getAutoVarName()));
+      } else if (conf::CodeGeneration::enableOptimizations && isOwnPropertyOnSelf(file, base) && res.prop->trivialReadVariable) {
+        // The getter just returns a variable, so read it directly.
+        return pex::PexValue::Identifier(file->getString(res.prop->trivialReadVariable->name));
       } else {
         auto ret = bldr.allocTemp(resultType());
         bldr << op::propget{ file->getString(res.prop->name), base, ret };
@@ -90,9 +93,12 @@ void PapyrusIdentifier::generateStore(pex::PexFile* file, pex::PexFunctionBuilde
     case PapyrusIdentifierType::Property:
       if (res.prop->isAutoReadOnly())
         bldr.reportingContext.fatal(location, "Attempted to generate a store to a read-only property!");
-      if (conf::CodeGeneration::enableCKOptimizations && res.prop->isAuto() && !res.prop->isAutoReadOnly() && !base.tmpVar && file->getStringValue(base.name) == "self") {
+      if (conf::CodeGeneration::enableCKOptimizations && isOwnPropertyOnSelf(file, base) && res.prop->isAuto() && !res.prop->isAutoReadOnly()) {
         // We can only do this for properties on ourselves. (CK does this even on parents)
         bldr << op::assign{ pex::PexValue::Identifier(file->getString(res.prop->getAutoVarName())), val };
+      } else if (conf::CodeGeneration::enableOptimizations && isOwnPropertyOnSelf(file, base) && res.prop->trivialWriteVariable) {
+        // The setter just assigns its parameter to a variable, so assign it directly.
+        bldr << op::assign{ pex::PexValue::Identifier(file->getString(res.prop->trivialWriteVariable->name)), val };
       } else {
         bldr << op::propset{ file->getString(res.prop->name), base, val };
       }
@@ -122,6 +128,10 @@ void PapyrusIdentifier::generateStore(pex::PexFile* file, pex::PexFunctionBuilde
   CapricaReportingContext::logicalFatal("Unknown PapyrusIdentifierType!");
 }
 
+bool PapyrusIdentifier::isOwnPropertyOnSelf(pex::PexFile* file, pex::PexValue::Identifier base) const {
+  return isPropertyOfCurrentObject && !base.tmpVar && file->getStringValue(base.name) == "self";
+}
+
 void PapyrusIdentifier::ensureAssignable(CapricaReportingContext& repCtx) const {
   switch (type) {
     case PapyrusIdentifierType::Property:
@@ -171,6 +181,10 @@ void PapyrusIdentifier::markRead() {
       return;
 
     case PapyrusIdentifierType::Property:
+      if (conf::General::wholeProgramAnalysis)
+        res.prop->isReferenced.store(true, std::memory_order_relaxed);
+      return;
+
     case PapyrusIdentifierType::Parameter:
     case PapyrusIdentifierType::DeclareStatement:
     case PapyrusIdentifierType::StructMember:
@@ -195,6 +209,10 @@ void PapyrusIdentifier::markWritten() {
       return;
 
     case PapyrusIdentifierType::Property:
+      if (conf::General::wholeProgramAnalysis)
+        res.prop->isReferenced.store(true, std::memory_order_relaxed);
+      return;
+
     case PapyrusIdentifierType::Parameter:
     case PapyrusIdentifierType::DeclareStatement:
     case PapyrusIdentifierType::StructMember:
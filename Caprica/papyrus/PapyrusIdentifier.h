@@ -111,6 +111,12 @@ private:
   friend expressions::PapyrusMemberAccessExpression;
   friend PapyrusResolutionContext;
 
+  // True if this is a property defined on the object currently
+  // being compiled, rather than on a parent or some other object.
+  bool isPropertyOfCurrentObject{ false };
+
+  bool isOwnPropertyOnSelf(pex::PexFile* file, pex::PexValue::Identifier base) const;
+
   PapyrusIdentifier(PapyrusIdentifierType k, CapricaFileLocation loc) : type(k), location(loc) { }
 };
 
@@ -0,0 +1,285 @@
+#include <papyrus/PapyrusInliner.h>
+
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <common/CapricaConfig.h>
+#include <common/CapricaReportingContext.h>
+#include <common/CaselessStringComparer.h>
+#include <common/allocators/ChainedPool.h>
+
+#include <papyrus/PapyrusFunction.h>
+#include <papyrus/PapyrusObject.h>
+
+namespace caprica { namespace papyrus {
+
+namespace {
+
+// The callee's body, built once into a file of its own so that
+// callers that reject it aren't left with its strings. These
+// live until releaseBodies() is called.
+struct InlineBody final
+{
+  pex::PexFile* file{ nullptr };
+  pex::PexFunction* function{ nullptr };
+  // The number of instructions inlining it emits, counting the
+  // assigns of the parameters and locals ahead of the body.
+  size_t size{ 0 };
+  // False if the body can't be inlined no matter the size.
+  bool isInlinable{ false };
+};
+
+}
+
+static std::mutex bodiesMutex{ };
+static std::unordered_map<const PapyrusFunction*, InlineBody> bodies{ };
+
+static bool isNoInline(const PapyrusFunction* func) {
+  auto flag = conf::Papyrus::userFlagsDefinition.tryFindFlag("NoInline");
+  return flag && (func->userFlags.data & flag->getData()) == flag->getData();
+}
+
+// The callee's object must have been through semantic2.
+//
+// This generates code for the callee's statements a second time,
+// possibly while its own compile job is doing the same. That only
+// reads the tree, so the one thing that can't be shared is the
+// reporting context: this reports into a silent one of its own, as
+// anything worth reporting will be by the callee's compile, and
+// the body is rejected if building it hits an error. No line map
+// is built, as the body takes the line of the call.
+static InlineBody buildBody(const PapyrusFunction* callee) {
+  InlineBody body{ };
+  CapricaReportingContext reportingContext{ callee->parentObject->getReportingContext().filename };
+  reportingContext.silent = true;
+  auto alloc = new allocators::ChainedPool(1024 * 4);
+  auto file = alloc->make<pex::PexFile>(alloc);
+  auto func = alloc->make<pex::PexFunction>();
+  try {
+    func->returnTypeName = callee->returnType.buildPex(file);
+    for (auto p : callee->parameters)
+      p->buildPex(file, nullptr, func);
+
+    pex::PexFunctionBuilder bldr{ reportingContext, callee->location, file };
+    // Calls in the body stay calls, so inlining never nests.
+    bldr.hotness = CapricaProfileHotness::Cold;
+    for (auto s : callee->statements)
+      s->buildPex(file, bldr);
+    bldr.populateFunction(func, nullptr);
+  } catch (const std::runtime_error&) {
+    delete alloc;
+    return body;
+  }
+  if (reportingContext.errorCount) {
+    delete alloc;
+    return body;
+  }
+  body.file = file;
+  body.function = func;
+
+  body.size = func->instructions.size() + func->parameters.size();
+  for (auto l : func->locals) {
+    if (file->getStringValue(l->name) != "::nonevar")
+      body.size++;
+  }
+
+  body.isInlinable = true;
+  for (auto instr : func->instructions) {
+    if (instr->opCode == pex::PexOpCode::CallStatic &&
+        idEq(file->getStringValue(instr->args[0].val.s), callee->parentObject->name) &&
+        idEq(file->getStringValue(instr->args[1].val.s), callee->name)) {
+      body.isInlinable = false;
+      break;
+    }
+  }
+  return body;
+}
+
+bool PapyrusInliner::tryInline(pex::PexFile* file,
+                               pex::PexFunctionBuilder& bldr,
+                               CapricaFileLocation location,
+                               const PapyrusFunction* callee,
+                               const IntrusiveLinkedList<pex::IntrusivePexValue>& arguments,
+                               pex::PexValue& result) {
+  namespace op = caprica::pex::op;
+  if (!conf::CodeGeneration::enableOptimizations || !conf::CodeGeneration::inlineThreshold)
+    return false;
+  if (bldr.hotness == CapricaProfileHotness::Cold)
+    return false;
+  if (!callee->isGlobal() || callee->isNative() || callee->functionType != PapyrusFunctionType::Function || isNoInline(callee))
+    return false;
+  // Objects reflected from Pex have no bodies to inline.
+  if (!callee->parentObject->awaitSemantic2())
+    return false;
+
+  auto threshold = conf::CodeGeneration::inlineThreshold;
+  if (bldr.hotness == CapricaProfileHotness::Hot)
+    threshold *= 2;
+
+  // The body is built without the lock held, so that building one
+  // doesn't hold up callers of others. If two callers race to build
+  // the same one, the first to finish wins.
+  InlineBody body;
+  bool found = false;
+  {
+    std::unique_lock<std::mutex> lock{ bodiesMutex };
+    auto f = bodies.find(callee);
+    if (f != bodies.end()) {
+      body = f->second;
+      found = true;
+    }
+  }
+  if (!found) {
+    auto built = buildBody(callee);
+    std::unique_lock<std::mutex> lock{ bodiesMutex };
+    auto f = bodies.emplace(callee, built);
+    if (!f.second && built.file)
+      delete built.file->alloc;
+    body = f.first->second;
+  }
+  if (!body.isInlinable || body.size > threshold)
+    return false;
+
+  auto calleeFile = body.file;
+  auto func = body.function;
+  std::vector<pex::PexInstruction*> instructions{ };
+  instructions.reserve(func->instructions.size());
+  for (auto i : func->instructions)
+    instructions.push_back(i);
+
+  // The parameters and locals of the callee become temps in the
+  // caller, and are reserved until the end of the body.
+  std::unordered_map<size_t, pex::PexValue> renamed{ };
+  std::vector<pex::PexLocalVariable*> temps{ };
+  const auto allocate = [&](pex::PexString name, pex::PexString type) {
+    auto t = bldr.allocLongLivedTemp(file->getString(calleeFile->getStringValue(type)));
+    temps.push_back(t);
+    renamed.emplace(name.index, pex::PexValue(t));
+    return t;
+  };
+  const auto translate = [&](const pex::PexValue& v, pex::PexInstructionArgKind kind) -> pex::PexValue {
+    if (v.type != pex::PexValueType::Identifier && v.type != pex::PexValueType::String)
+      return v;
+    if (v.type == pex::PexValueType::Identifier && kind != pex::PexInstructionArgKind::Name) {
+      auto f = renamed.find(v.val.s.index);
+      if (f != renamed.end())
+        return f->second;
+    }
+    pex::PexValue ret = v;
+    ret.val.s = file->getString(calleeFile->getStringValue(v.val.s));
+    return ret;
+  };
+
+  bldr << location;
+  auto arg = arguments.begin();
+  for (auto p : func->parameters) {
+    auto t = allocate(p->name, p->type);
+    bldr << op::assign{ t, **arg };
+    ++arg;
+  }
+  // Locals start out as the default value of their type on each
+  // call, which the temps standing in for them have to match, as
+  // they may still hold whatever they were last used for.
+  for (auto l : func->locals) {
+    if (calleeFile->getStringValue(l->name) == "::nonevar") {
+      renamed.emplace(l->name.index, pex::PexValue(bldr.getNoneLocal(location)));
+      continue;
+    }
+    auto t = allocate(l->name, l->type);
+    auto typeName = calleeFile->getStringValue(l->type);
+    auto defaultValue = PapyrusValue::None(location);
+    if (idEq(typeName, "int"))
+      defaultValue = PapyrusValue::Integer(location, 0);
+    else if (idEq(typeName, "float"))
+      defaultValue = PapyrusValue::Float(location, 0.0f);
+    else if (idEq(typeName, "bool"))
+      defaultValue = PapyrusValue::Bool(location, false);
+    else if (idEq(typeName, "string"))
+      defaultValue = PapyrusValue::String(location, "");
+    bldr << op::assign{ t, defaultValue.buildPex(file) };
+  }
+
+  auto count = instructions.size();
+  std::vector<pex::PexLabel*> labels(count + 1, nullptr);
+  size_t returnCount = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (instructions[i]->isBranch()) {
+      auto target = (size_t)((int64_t)i + instructions[i]->branchTarget());
+      if (!labels[target])
+        labels[target] = bldr.label();
+    }
+    if (instructions[i]->opCode == pex::PexOpCode::Return)
+      returnCount++;
+  }
+  const auto endLabel = [&]() {
+    if (!labels[count])
+      labels[count] = bldr.label();
+    return labels[count];
+  };
+
+  // With a single return at the very end, the value can go
+  // straight to the result.
+  bool returnsValue = callee->returnType.type != PapyrusType::Kind::None;
+  bool hasSingleReturn = returnCount == 1 && count && instructions[count - 1]->opCode == pex::PexOpCode::Return;
+  pex::PexValue dest = pex::PexValue::Invalid();
+  pex::PexLocalVariable* resultVar = nullptr;
+  if (returnsValue) {
+    dest = bldr.allocTemp(callee->returnType);
+    if (!hasSingleReturn)
+      resultVar = bldr.allocLongLivedTemp(callee->returnType);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (labels[i])
+      bldr << labels[i];
+    auto instr = instructions[i];
+    if (instr->opCode == pex::PexOpCode::Return) {
+      auto value = translate(instr->args[0], pex::PexInstructionArgKind::Value);
+      if (resultVar)
+        bldr << op::assign{ resultVar, value };
+      else if (returnsValue)
+        bldr << op::assign{ pex::PexValue::Identifier::fromVar(dest), value };
+      if (i != count - 1)
+        bldr << op::jmp{ endLabel() };
+      continue;
+    }
+
+    pex::PexInstructionArgs args{ };
+    for (size_t a = 0; a < instr->args.size(); a++) {
+      auto kind = pex::PexInstruction::getArgKindForOpCode(instr->opCode, a);
+      if (kind == pex::PexInstructionArgKind::Target)
+        args.push_back(pex::PexValue(labels[(size_t)((int64_t)i + instr->branchTarget())]));
+      else
+        args.push_back(translate(instr->args[a], kind));
+    }
+    IntrusiveLinkedList<pex::IntrusivePexValue> variadicArgs{ };
+    for (auto v : instr->variadicArgs)
+      variadicArgs.push_back(bldr.alloc->make<pex::IntrusivePexValue>(translate(*v, pex::PexInstructionArgKind::Value)));
+    bldr << bldr.alloc->make<pex::PexInstruction>(instr->opCode, std::move(args), std::move(variadicArgs));
+  }
+  if (labels[count])
+    bldr << labels[count];
+
+  if (resultVar) {
+    bldr << op::assign{ pex::PexValue::Identifier::fromVar(dest), resultVar };
+    bldr.freeLongLivedTemp(resultVar);
+  }
+  for (auto t : temps)
+    bldr.freeLongLivedTemp(t);
+
+  result = dest;
+  return true;
+}
+
+void PapyrusInliner::releaseBodies() {
+  std::unique_lock<std::mutex> lock{ bodiesMutex };
+  for (auto& b : bodies) {
+    if (b.second.file)
+      delete b.second.file->alloc;
+  }
+  bodies.clear();
+}
+
+}}
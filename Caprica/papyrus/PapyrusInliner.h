@@ -0,0 +1,33 @@
+#pragma once
+
+#include <common/CapricaFileLocation.h>
+#include <common/IntrusiveLinkedList.h>
+
+#include <pex/PexFile.h>
+#include <pex/PexFunctionBuilder.h>
+#include <pex/PexValue.h>
+
+namespace caprica { namespace papyrus {
+
+struct PapyrusFunction;
+
+// Substitutes the bodies of small Global functions for calls to
+// them, as a CallStatic is expensive in the VM.
+struct PapyrusInliner final
+{
+  // Emit the body of the callee in place of a call to it, with the
+  // arguments already loaded. The inlined instructions are all
+  // attributed to the location of the call. Returns false, having
+  // emitted nothing, if the callee can't be inlined here.
+  static bool tryInline(pex::PexFile* file,
+                        pex::PexFunctionBuilder& bldr,
+                        CapricaFileLocation location,
+                        const PapyrusFunction* callee,
+                        const IntrusiveLinkedList<pex::IntrusivePexValue>& arguments,
+                        pex::PexValue& result);
+  // Free the callee bodies built for inlining. No more calls may be
+  // compiled after this.
+  static void releaseBodies();
+};
+
+}}
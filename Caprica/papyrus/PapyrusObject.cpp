@@ -8,6 +8,14 @@ PapyrusObject* PapyrusObject::awaitSemantic() const {
   return compilationNode->awaitSemantic();
 }
 
+PapyrusObject* PapyrusObject::awaitSemantic2() const {
+  return compilationNode->awaitSemantic2();
+}
+
+CapricaReportingContext& PapyrusObject::getReportingContext() const {
+  return compilationNode->getReportingContext();
+}
+
 PapyrusPropertyGroup* PapyrusObject::getRootPropertyGroup() {
   if (!rootPropertyGroup) {
     rootPropertyGroup = new PapyrusPropertyGroup(location);
@@ -25,6 +33,63 @@ const PapyrusObject* PapyrusObject::tryGetParentClass() const {
   return nullptr;
 }
 
+void PapyrusObject::reportUnreferencedMembers(CapricaReportingContext& repCtx) const {
+  // Calls resolve by name, so a function counts as called if
+  // its counterpart in any state is.
+  caseless_unordered_identifier_ref_set calledFunctions{ };
+  for (auto s : states) {
+    for (auto f : s->functions) {
+      if (f.second->isCalled.load(std::memory_order_relaxed))
+        calledFunctions.insert(f.second->name);
+    }
+  }
+
+  const auto overridesParent = [this](const identifier_ref& name) {
+    for (auto p = tryGetParentClass(); p != nullptr; p = p->tryGetParentClass()) {
+      if (p->getRootState()->functions.count(name))
+        return true;
+    }
+    return false;
+  };
+
+  for (auto s : states) {
+    for (auto f : s->functions) {
+      auto func = f.second;
+      // Events are called by the game, natives have no body to remove,
+      // and anything overriding a parent can be reached through it.
+      if (func->functionType != PapyrusFunctionType::Function || func->isNative())
+        continue;
+      if (calledFunctions.count(func->name) || overridesParent(func->name))
+        continue;
+      repCtx.warning_W4008_Uncalled_Function(func->location, func->name.to_string().c_str());
+    }
+  }
+
+  for (auto g : propertyGroups) {
+    for (auto p : g->properties) {
+      if (!p->isReferenced.load(std::memory_order_relaxed))
+        repCtx.warning_W4009_Unreferenced_Property(p->location, p->name.to_string().c_str());
+    }
+  }
+}
+
+void PapyrusObject::resolveAncestry() {
+  ancestors.clear();
+  if (auto parClass = tryGetParentClass()) {
+    if (parClass->hasResolvedAncestry()) {
+      ancestors.reserve(parClass->ancestors.size() + 1);
+      ancestors.insert(ancestors.end(), parClass->ancestors.begin(), parClass->ancestors.end());
+    } else {
+      // The parent has already been awaited, so this shouldn't
+      // happen, but walk the chain rather than rely on it.
+      for (auto p = parClass; p != nullptr && p != this; p = p->tryGetParentClass())
+        ancestors.insert(ancestors.begin(), p);
+    }
+  }
+  ancestors.push_back(this);
+  ancestryResolved.store(true, std::memory_order_release);
+}
+
 void PapyrusObject::buildPex(CapricaReportingContext& repCtx, pex::PexFile* file) const {
   auto obj = file->alloc->make<pex::PexObject>();
   obj->name = file->getString(name);
@@ -72,6 +137,7 @@ void PapyrusObject::semantic(PapyrusResolutionContext* ctx) {
   resolutionState = PapyrusResoultionState::SemanticInProgress;
   if (auto c = this->tryGetParentClass())
     c->awaitSemantic();
+  resolveAncestry();
   ctx->object = this;
   for (auto i : imports)
     ctx->addImport(i.first, i.second);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -89,9 +90,20 @@ struct PapyrusObject final
   }
 
   const PapyrusObject* tryGetParentClass() const;
+
+  // The inheritance chain, root-most class first and this object
+  // last. Only available once the semantic pass has resolved the
+  // parent class, check hasResolvedAncestry() first.
+  bool hasResolvedAncestry() const { return ancestryResolved.load(std::memory_order_acquire); }
+  size_t inheritanceDepth() const { return ancestors.size() - 1; }
+  const PapyrusObject* ancestorAt(size_t depth) const { return ancestors[depth]; }
   void buildPex(CapricaReportingContext& repCtx, pex::PexFile* file) const;
   void semantic(PapyrusResolutionContext* ctx);
   void semantic2(PapyrusResolutionContext* ctx);
+  // Warn about the functions and properties that nothing references.
+  // This is only meaningful once every file being compiled has been
+  // through semantic2.
+  void reportUnreferencedMembers(CapricaReportingContext& repCtx) const;
 
   void preSemantic(PapyrusResolutionContext* ctx) {
     resolutionState = PapyrusResoultionState::PreSemanticInProgress;
@@ -100,6 +112,9 @@ struct PapyrusObject final
   }
 
   PapyrusObject* awaitSemantic() const;
+  // Returns nullptr if the object has no function bodies to resolve.
+  PapyrusObject* awaitSemantic2() const;
+  CapricaReportingContext& getReportingContext() const;
 
 private:
   friend PapyrusCompilationNode;
@@ -111,6 +126,10 @@ private:
   PapyrusState* rootState{ nullptr };
   PapyrusPropertyGroup* rootPropertyGroup{ nullptr };
   mutable std::string lowerName{ };
+  std::vector<const PapyrusObject*> ancestors{ };
+  std::atomic<bool> ancestryResolved{ false };
+
+  void resolveAncestry();
 
   void checkForInheritedIdentifierConflicts(CapricaReportingContext& repCtx, caseless_unordered_identifier_ref_map<std::pair<bool, const char*>>& identMap, bool checkInheritedOnly) const;
 };
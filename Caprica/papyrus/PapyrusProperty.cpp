@@ -1,6 +1,11 @@
 #include <papyrus/PapyrusProperty.h>
 
 #include <papyrus/PapyrusObject.h>
+#include <papyrus/PapyrusVariable.h>
+#include <papyrus/expressions/PapyrusIdentifierExpression.h>
+#include <papyrus/statements/PapyrusAssignStatement.h>
+#include <papyrus/statements/PapyrusReturnStatement.h>
+#include <papyrus/statements/PapyrusStatementVisitor.h>
 
 #include <pex/PexDebugFunctionInfo.h>
 #include <pex/PexFunction.h>
@@ -84,6 +89,51 @@ void PapyrusProperty::semantic2(PapyrusResolutionContext* ctx) {
       ctx->reportingContext.error(writeFunction->location, "A property function is not allowed to be global or native.");
     writeFunction->semantic2(ctx);
   }
+  findTrivialAccessorVariables();
+}
+
+void PapyrusProperty::findTrivialAccessorVariables() {
+  struct TrivialAccessorStatementVisitor final : statements::PapyrusSelectiveStatementVisitor
+  {
+    const PapyrusFunctionParameter* param{ nullptr };
+    const PapyrusVariable* var{ nullptr };
+    TrivialAccessorStatementVisitor(const PapyrusFunctionParameter* p) : param(p) { }
+
+    virtual void visit(statements::PapyrusReturnStatement* s) override {
+      if (param || !s->returnValue)
+        return;
+      if (auto id = s->returnValue->asIdentifierExpression()) {
+        if (id->identifier.type == PapyrusIdentifierType::Variable)
+          var = id->identifier.res.var;
+      }
+    }
+
+    virtual void visit(statements::PapyrusAssignStatement* s) override {
+      if (!param || s->operation != statements::PapyrusAssignOperatorType::Assign)
+        return;
+      auto lId = s->lValue->asIdentifierExpression();
+      auto rId = s->rValue->asIdentifierExpression();
+      if (lId && rId && lId->identifier.type == PapyrusIdentifierType::Variable &&
+          rId->identifier.type == PapyrusIdentifierType::Parameter && rId->identifier.res.param == param) {
+        var = lId->identifier.res.var;
+      }
+    }
+  };
+
+  // The coercions done in the semantic pass mean the expressions are
+  // only bare identifiers if the types already match exactly.
+  if (readFunction && readFunction->statements.size() == 1) {
+    TrivialAccessorStatementVisitor visitor{ nullptr };
+    readFunction->statements.front()->visit(visitor);
+    if (visitor.var && visitor.var->parent == parent)
+      trivialReadVariable = visitor.var;
+  }
+  if (writeFunction && writeFunction->statements.size() == 1 && writeFunction->parameters.size() == 1) {
+    TrivialAccessorStatementVisitor visitor{ writeFunction->parameters.front() };
+    writeFunction->statements.front()->visit(visitor);
+    if (visitor.var && visitor.var->parent == parent)
+      trivialWriteVariable = visitor.var;
+  }
 }
 
 }}
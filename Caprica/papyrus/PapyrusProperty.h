@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 
 #include <common/CapricaFileLocation.h>
@@ -17,6 +18,8 @@
 
 namespace caprica { namespace papyrus {
 
+struct PapyrusVariable;
+
 struct PapyrusProperty final
 {
   identifier_ref name{ "" };
@@ -30,6 +33,15 @@ struct PapyrusProperty final
   CapricaFileLocation location;
   const PapyrusObject* parent{ nullptr };
 
+  // Set by semantic2 if the read or write function does nothing but
+  // directly return, or assign its parameter to, one of our variables.
+  const PapyrusVariable* trivialReadVariable{ nullptr };
+  const PapyrusVariable* trivialWriteVariable{ nullptr };
+
+  // Set when any of the scripts being compiled reads or writes this
+  // property. Files are resolved in parallel, hence the atomic.
+  mutable std::atomic<bool> isReferenced{ false };
+
   bool isAuto() const { return userFlags.isAuto; }
   bool isAutoReadOnly() const { return userFlags.isAutoReadOnly; }
   bool isConst() const { return userFlags.isConst; }
@@ -51,6 +63,8 @@ struct PapyrusProperty final
 private:
   friend IntrusiveLinkedList<PapyrusProperty>;
   PapyrusProperty* next{ nullptr };
+
+  void findTrivialAccessorVariables();
 };
 
 }}
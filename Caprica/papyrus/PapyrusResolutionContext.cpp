@@ -38,6 +38,15 @@ void PapyrusResolutionContext::addImport(const CapricaFileLocation& location, co
 bool PapyrusResolutionContext::isObjectSomeParentOf(const PapyrusObject* child, const PapyrusObject* parent) {
   if (child == parent)
     return true;
+  if (child->hasResolvedAncestry() && parent->hasResolvedAncestry()) {
+    // If parent is an ancestor at all, it has to be at the same
+    // depth in child's chain as it is in its own.
+    auto depth = parent->inheritanceDepth();
+    if (depth > child->inheritanceDepth())
+      return false;
+    auto ancestor = child->ancestorAt(depth);
+    return ancestor == parent || idEq(ancestor->name, parent->name);
+  }
   if (idEq(child->name, parent->name))
     return true;
   if (auto parentObject = child->tryGetParentClass())
@@ -323,16 +332,29 @@ PapyrusType PapyrusResolutionContext::resolveType(PapyrusType tp, bool lazy) {
   reportingContext.fatal(tp.location, "Unable to resolve a struct named '%s' in script '%s'!", retStructName.to_string().c_str(), foundObj->name.to_string().c_str());
 }
 
+void PapyrusResolutionContext::popLocalVariableScope() {
+  assert(!localVariableScopeStarts.empty());
+  auto scopeStart = localVariableScopeStarts.back();
+  localVariableScopeStarts.pop_back();
+  if (localVariableScopeStarts.empty()) {
+    // Leaving the function, clear rather than erase so the
+    // buckets get reused by the next one.
+    localVariables.clear();
+    localVariableDeclarationOrder.clear();
+    return;
+  }
+  for (size_t i = scopeStart; i < localVariableDeclarationOrder.size(); i++)
+    localVariables.erase(localVariableDeclarationOrder[i]);
+  localVariableDeclarationOrder.resize(scopeStart);
+}
+
 void PapyrusResolutionContext::addLocalVariable(statements::PapyrusDeclareStatement* local) {
-  for (auto is : localVariableScopeStack) {
-    for (auto n : is->locals) {
-      if (idEq(n->name, local->name)) {
-        reportingContext.error(local->location, "Attempted to redefined '%s' which was already defined in a parent scope!", local->name.to_string().c_str());
-        return;
-      }
-    }
+  assert(!localVariableScopeStarts.empty());
+  if (!localVariables.emplace(local->name, local).second) {
+    reportingContext.error(local->location, "Attempted to redefined '%s' which was already defined in a parent scope!", local->name.to_string().c_str());
+    return;
   }
-  localVariableScopeStack.top()->locals.push_back(allocator->make<LocalScopeVariableNode>(local->name, local));
+  localVariableDeclarationOrder.push_back(local->name);
 }
 
 PapyrusIdentifier PapyrusResolutionContext::resolveIdentifier(const PapyrusIdentifier& ident) const {
@@ -347,12 +369,10 @@ PapyrusIdentifier PapyrusResolutionContext::tryResolveIdentifier(const PapyrusId
     return ident;
 
   // This handles local var resolution.
-  for (auto stack : localVariableScopeStack) {
-    for (auto n : stack->locals) {
-      if (idEq(n->name, ident.res.name)) {
-        return PapyrusIdentifier::DeclStatement(ident.location, n->declareStatement);
-      }
-    }
+  if (!localVariables.empty()) {
+    auto f = localVariables.find(ident.res.name);
+    if (f != localVariables.end())
+      return PapyrusIdentifier::DeclStatement(ident.location, f->second);
   }
 
   if (function) {
@@ -376,8 +396,11 @@ PapyrusIdentifier PapyrusResolutionContext::tryResolveIdentifier(const PapyrusId
 
     for (auto pg : object->propertyGroups) {
       for (auto p : pg->properties) {
-        if (idEq(p->name, ident.res.name))
-          return PapyrusIdentifier::Property(ident.location, p);
+        if (idEq(p->name, ident.res.name)) {
+          auto id = PapyrusIdentifier::Property(ident.location, p);
+          id.isPropertyOfCurrentObject = true;
+          return id;
+        }
       }
     }
   }
@@ -408,8 +431,11 @@ PapyrusIdentifier PapyrusResolutionContext::tryResolveMemberIdentifier(const Pap
   } else if (baseType.type == PapyrusType::Kind::ResolvedObject) {
     for (auto& propGroup : baseType.resolved.obj->awaitSemantic()->propertyGroups) {
       for (auto& prop : propGroup->properties) {
-        if (idEq(prop->name, ident.res.name))
-          return PapyrusIdentifier::Property(ident.location, prop);
+        if (idEq(prop->name, ident.res.name)) {
+          auto id = PapyrusIdentifier::Property(ident.location, prop);
+          id.isPropertyOfCurrentObject = prop->parent == object;
+          return id;
+        }
       }
     }
 
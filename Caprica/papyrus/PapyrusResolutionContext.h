@@ -9,7 +9,6 @@
 #include <common/CaselessStringComparer.h>
 #include <common/identifier_ref.h>
 #include <common/IntrusiveLinkedList.h>
-#include <common/IntrusiveStack.h>
 
 namespace caprica { namespace papyrus { struct PapyrusResolutionContext; } }
 
@@ -57,8 +56,8 @@ struct PapyrusResolutionContext final
   void checkForPoison(const expressions::PapyrusExpression* expr) const;
   void checkForPoison(const PapyrusType& type) const;
 
-  void pushLocalVariableScope() { localVariableScopeStack.push(allocator->make<LocalScopeStackNode>()); }
-  void popLocalVariableScope() { localVariableScopeStack.pop(); }
+  void pushLocalVariableScope() { localVariableScopeStarts.push_back(localVariableDeclarationOrder.size()); }
+  void popLocalVariableScope();
 
   bool canBreak() const { return currentBreakScopeDepth > 0; }
   void pushBreakScope() { currentBreakScopeDepth++; }
@@ -112,25 +111,12 @@ struct PapyrusResolutionContext final
   PapyrusResolutionContext(const PapyrusResolutionContext&) = delete;
   ~PapyrusResolutionContext() = default;
 private:
-  struct LocalScopeVariableNode final
-  {
-    identifier_ref name{ };
-    statements::PapyrusDeclareStatement* declareStatement{ nullptr };
-
-    LocalScopeVariableNode(const identifier_ref& nm, statements::PapyrusDeclareStatement* decl) : name(nm), declareStatement(decl) { }
-  private:
-    friend IntrusiveLinkedList<LocalScopeVariableNode>;
-    LocalScopeVariableNode* next{ nullptr };
-  };
-  struct LocalScopeStackNode final
-  {
-    IntrusiveLinkedList<LocalScopeVariableNode> locals{ };
-
-  private:
-    friend IntrusiveStack<LocalScopeStackNode>;
-    LocalScopeStackNode* nextInStack{ nullptr };
-  };
-  IntrusiveStack<LocalScopeStackNode> localVariableScopeStack{ };
+  // Locals can't shadow other locals, so a single map is enough
+  // for every scope in the function; the declaration order is used
+  // to remove a scope's locals when it is popped.
+  caseless_unordered_identifier_ref_map<statements::PapyrusDeclareStatement*> localVariables{ };
+  std::vector<identifier_ref> localVariableDeclarationOrder{ };
+  std::vector<size_t> localVariableScopeStarts{ };
   std::vector<PapyrusCompilationNode*> importedNodes{ };
   size_t currentBreakScopeDepth{ 0 };
   size_t currentContinueScopeDepth{ 0 };
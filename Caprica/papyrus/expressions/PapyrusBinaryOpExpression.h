@@ -1,6 +1,13 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <common/CapricaConfig.h>
+
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 
 #include <pex/PexFile.h>
 #include <pex/PexFunctionBuilder.h>
@@ -42,6 +49,8 @@ struct PapyrusBinaryOpExpression final : public PapyrusExpression
 
   virtual pex::PexValue generateLoad(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override {
     namespace op = caprica::pex::op;
+    if (foldedValue)
+      return foldedValue->generateLoad(file, bldr);
     auto lVal = left->generateLoad(file, bldr);
     auto dest = bldr.allocTemp(this->resultType());
     if (operation == PapyrusBinaryOperatorType::BooleanOr) {
@@ -148,6 +157,49 @@ struct PapyrusBinaryOpExpression final : public PapyrusExpression
     ctx->checkForPoison(left);
     right->semantic(ctx);
     ctx->checkForPoison(right);
+    coerceOperands(ctx);
+    if (conf::CodeGeneration::enableOptimizations)
+      tryFold(ctx);
+  }
+
+  virtual PapyrusType resultType() const override {
+    if (foldedValue)
+      return foldedValue->resultType();
+    // This is dependent on the operator.
+    switch (operation) {
+      case PapyrusBinaryOperatorType::BooleanOr:
+      case PapyrusBinaryOperatorType::BooleanAnd:
+      case PapyrusBinaryOperatorType::CmpEq:
+      case PapyrusBinaryOperatorType::CmpNeq:
+      case PapyrusBinaryOperatorType::CmpLt:
+      case PapyrusBinaryOperatorType::CmpLte:
+      case PapyrusBinaryOperatorType::CmpGt:
+      case PapyrusBinaryOperatorType::CmpGte:
+        return PapyrusType::Bool(location);
+
+      case PapyrusBinaryOperatorType::Add:
+      case PapyrusBinaryOperatorType::Subtract:
+      case PapyrusBinaryOperatorType::Multiply:
+      case PapyrusBinaryOperatorType::Divide:
+      case PapyrusBinaryOperatorType::Modulus:
+        return left->resultType();
+
+      case PapyrusBinaryOperatorType::None:
+        break;
+    }
+    CapricaReportingContext::logicalFatal("Unknown PapyrusBinaryOperatorType!");
+  }
+
+  // If the expression was folded, this is the literal it was folded
+  // to, and is what gets coerced and loaded in its place.
+  virtual PapyrusLiteralExpression* asLiteralExpression() override {
+    return foldedValue;
+  }
+
+private:
+  PapyrusLiteralExpression* foldedValue{ nullptr };
+
+  void coerceOperands(PapyrusResolutionContext* ctx) {
     switch (operation) {
       case PapyrusBinaryOperatorType::BooleanOr:
       case PapyrusBinaryOperatorType::BooleanAnd:
@@ -185,33 +237,144 @@ struct PapyrusBinaryOpExpression final : public PapyrusExpression
     CapricaReportingContext::logicalFatal("Unknown PapyrusBinaryOperatorType in semantic pass!");
   }
 
-  virtual PapyrusType resultType() const override {
-    // This is dependent on the operator.
+  void tryFold(PapyrusResolutionContext* ctx) {
+    auto lLit = left->asLiteralExpression();
+    auto rLit = right->asLiteralExpression();
+    if (!lLit)
+      return;
+    auto& l = lLit->value;
+
+    // The right side is never evaluated if the left side decides the
+    // result, so it doesn't matter whether or not it's a literal.
+    if (operation == PapyrusBinaryOperatorType::BooleanOr || operation == PapyrusBinaryOperatorType::BooleanAnd) {
+      if (l.type != PapyrusValueType::Bool)
+        return;
+      if (operation == PapyrusBinaryOperatorType::BooleanOr && l.val.b)
+        return foldTo(ctx, PapyrusValue::Bool(location, true));
+      if (operation == PapyrusBinaryOperatorType::BooleanAnd && !l.val.b)
+        return foldTo(ctx, PapyrusValue::Bool(location, false));
+      if (rLit && rLit->value.type == PapyrusValueType::Bool)
+        return foldTo(ctx, PapyrusValue::Bool(location, rLit->value.val.b));
+      return;
+    }
+
+    if (!rLit || l.type != rLit->value.type)
+      return;
+    auto& r = rLit->value;
+    switch (l.type) {
+      case PapyrusValueType::Integer:
+        return foldInt(ctx, l.val.i, r.val.i);
+      case PapyrusValueType::Float:
+        return foldFloat(ctx, l.val.f, r.val.f);
+      case PapyrusValueType::Bool:
+        if (operation == PapyrusBinaryOperatorType::CmpEq)
+          return foldTo(ctx, PapyrusValue::Bool(location, l.val.b == r.val.b));
+        if (operation == PapyrusBinaryOperatorType::CmpNeq)
+          return foldTo(ctx, PapyrusValue::Bool(location, l.val.b != r.val.b));
+        return;
+      case PapyrusValueType::String:
+        // String comparison in the VM is case-insensitive.
+        if (operation == PapyrusBinaryOperatorType::CmpEq)
+          return foldTo(ctx, PapyrusValue::Bool(location, idEq(l.val.s, r.val.s)));
+        if (operation == PapyrusBinaryOperatorType::CmpNeq)
+          return foldTo(ctx, PapyrusValue::Bool(location, !idEq(l.val.s, r.val.s)));
+        if (operation == PapyrusBinaryOperatorType::Add)
+          return foldTo(ctx, PapyrusValue::String(location, ctx->allocator->allocateIdentifier(l.val.s.to_string() + r.val.s.to_string())));
+        return;
+      case PapyrusValueType::None:
+      case PapyrusValueType::Invalid:
+        return;
+    }
+    CapricaReportingContext::logicalFatal("Unknown PapyrusValueType!");
+  }
+
+  void foldInt(PapyrusResolutionContext* ctx, int32_t l, int32_t r) {
+    // The VM's integer math wraps, so do the math unsigned to get
+    // the same result without relying on signed overflow.
+    auto ul = (uint32_t)l;
+    auto ur = (uint32_t)r;
     switch (operation) {
-      case PapyrusBinaryOperatorType::BooleanOr:
-      case PapyrusBinaryOperatorType::BooleanAnd:
       case PapyrusBinaryOperatorType::CmpEq:
+        return foldTo(ctx, PapyrusValue::Bool(location, l == r));
       case PapyrusBinaryOperatorType::CmpNeq:
+        return foldTo(ctx, PapyrusValue::Bool(location, l != r));
       case PapyrusBinaryOperatorType::CmpLt:
+        return foldTo(ctx, PapyrusValue::Bool(location, l < r));
       case PapyrusBinaryOperatorType::CmpLte:
+        return foldTo(ctx, PapyrusValue::Bool(location, l <= r));
       case PapyrusBinaryOperatorType::CmpGt:
+        return foldTo(ctx, PapyrusValue::Bool(location, l > r));
       case PapyrusBinaryOperatorType::CmpGte:
-        return PapyrusType::Bool(location);
-
+        return foldTo(ctx, PapyrusValue::Bool(location, l >= r));
       case PapyrusBinaryOperatorType::Add:
+        return foldTo(ctx, PapyrusValue::Integer(location, (int32_t)(ul + ur)));
       case PapyrusBinaryOperatorType::Subtract:
+        return foldTo(ctx, PapyrusValue::Integer(location, (int32_t)(ul - ur)));
       case PapyrusBinaryOperatorType::Multiply:
+        return foldTo(ctx, PapyrusValue::Integer(location, (int32_t)(ul * ur)));
       case PapyrusBinaryOperatorType::Divide:
       case PapyrusBinaryOperatorType::Modulus:
-        return left->resultType();
+        // Leave anything that would fault at runtime alone.
+        if (r == 0 || (l == std::numeric_limits<int32_t>::min() && r == -1))
+          return;
+        if (operation == PapyrusBinaryOperatorType::Divide)
+          return foldTo(ctx, PapyrusValue::Integer(location, l / r));
+        return foldTo(ctx, PapyrusValue::Integer(location, l % r));
 
+      case PapyrusBinaryOperatorType::BooleanOr:
+      case PapyrusBinaryOperatorType::BooleanAnd:
       case PapyrusBinaryOperatorType::None:
-        break;
+        return;
     }
     CapricaReportingContext::logicalFatal("Unknown PapyrusBinaryOperatorType!");
   }
 
-private:
+  void foldFloat(PapyrusResolutionContext* ctx, float l, float r) {
+    float res = 0.0f;
+    switch (operation) {
+      case PapyrusBinaryOperatorType::CmpEq:
+        return foldTo(ctx, PapyrusValue::Bool(location, l == r));
+      case PapyrusBinaryOperatorType::CmpNeq:
+        return foldTo(ctx, PapyrusValue::Bool(location, l != r));
+      case PapyrusBinaryOperatorType::CmpLt:
+        return foldTo(ctx, PapyrusValue::Bool(location, l < r));
+      case PapyrusBinaryOperatorType::CmpLte:
+        return foldTo(ctx, PapyrusValue::Bool(location, l <= r));
+      case PapyrusBinaryOperatorType::CmpGt:
+        return foldTo(ctx, PapyrusValue::Bool(location, l > r));
+      case PapyrusBinaryOperatorType::CmpGte:
+        return foldTo(ctx, PapyrusValue::Bool(location, l >= r));
+      case PapyrusBinaryOperatorType::Add:
+        res = l + r;
+        break;
+      case PapyrusBinaryOperatorType::Subtract:
+        res = l - r;
+        break;
+      case PapyrusBinaryOperatorType::Multiply:
+        res = l * r;
+        break;
+      case PapyrusBinaryOperatorType::Divide:
+        if (r == 0.0f)
+          return;
+        res = l / r;
+        break;
+
+      case PapyrusBinaryOperatorType::Modulus:
+      case PapyrusBinaryOperatorType::BooleanOr:
+      case PapyrusBinaryOperatorType::BooleanAnd:
+      case PapyrusBinaryOperatorType::None:
+        return;
+    }
+    // Don't bake infinities or NaNs into the output.
+    if (!std::isfinite(res))
+      return;
+    foldTo(ctx, PapyrusValue::Float(location, res));
+  }
+
+  void foldTo(PapyrusResolutionContext* ctx, PapyrusValue&& val) {
+    foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, std::move(val));
+  }
+
   void coerceToSameType(PapyrusResolutionContext* ctx) {
     if (left->resultType().type == PapyrusType::Kind::String || right->resultType().type == PapyrusType::Kind::String) {
       left = ctx->coerceExpression(left, PapyrusType::String(left->location));
@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include <papyrus/PapyrusFunction.h>
+#include <papyrus/PapyrusInliner.h>
 #include <papyrus/PapyrusObject.h>
 #include <papyrus/expressions/PapyrusLiteralExpression.h>
 #include <papyrus/expressions/PapyrusParentExpression.h>
@@ -11,6 +12,16 @@ namespace caprica { namespace papyrus { namespace expressions {
 
 static constexpr size_t MaxBuiltinArrayFunctionArgumentCount = 3;
 
+// The literal an argument was written as, or nullptr if it wasn't
+// one. Expressions folded to a literal don't count, so that which
+// arguments are accepted doesn't depend on the optimization level.
+static PapyrusLiteralExpression* asWrittenLiteral(PapyrusExpression* expr) {
+  auto le = expr->asLiteralExpression();
+  if (le != expr)
+    return nullptr;
+  return le;
+}
+
 pex::PexValue PapyrusFunctionCallExpression::generateLoad(pex::PexFile* file, pex::PexFunctionBuilder& bldr, PapyrusExpression* base) const {
   if (!shouldEmit)
     return pex::PexValue::Invalid();
@@ -112,11 +123,16 @@ pex::PexValue PapyrusFunctionCallExpression::generateLoad(pex::PexFile* file, pe
       else
         return bldr.allocTemp(tp);
     };
-    auto dest = getDest(bldr, location, function.res.func->returnType);
-
     IntrusiveLinkedList<pex::IntrusivePexValue> args;
     for (auto param : arguments)
       args.push_back(file->alloc->make<pex::IntrusivePexValue>(param->value->generateLoad(file, bldr)));
+    if (function.res.func->isGlobal()) {
+      pex::PexValue inlinedResult;
+      if (PapyrusInliner::tryInline(file, bldr, location, function.res.func, args, inlinedResult))
+        return inlinedResult;
+    }
+
+    auto dest = getDest(bldr, location, function.res.func->returnType);
     bldr << location;
     if (function.res.func->isGlobal()) {
       bldr << op::callstatic{ file->getString(function.res.func->parentObject->loweredName()), file->getString(function.res.func->name), dest, std::move(args) };
@@ -183,10 +199,11 @@ void PapyrusFunctionCallExpression::semantic(PapyrusResolutionContext* ctx, Papy
       case PapyrusBuiltinArrayFunctionKind::FindStruct:
       {
         getArgs("FindStruct", 2, 3);
-        if (args[0]->value->resultType().type != PapyrusType::Kind::String)
+        auto memberLiteral = asWrittenLiteral(args[0]->value);
+        if (!memberLiteral || memberLiteral->value.type != PapyrusValueType::String)
           ctx->reportingContext.fatal(location, "Expected the literal name of the struct member as a string to compare against!");
-        
-        auto memberName = args[0]->value->asLiteralExpression()->value.val.s;
+
+        auto memberName = memberLiteral->value.val.s;
         PapyrusType elemType = PapyrusType::Default();
         for (auto m : function.res.arrayFuncElementType->resolved.struc->members) {
           if (idEq(m->name, memberName)) {
@@ -227,10 +244,11 @@ void PapyrusFunctionCallExpression::semantic(PapyrusResolutionContext* ctx, Papy
       case PapyrusBuiltinArrayFunctionKind::RFindStruct:
       {
         getArgs("RFindStruct", 2, 3);
-        if (args[0]->value->resultType().type != PapyrusType::Kind::String)
+        auto memberLiteral = asWrittenLiteral(args[0]->value);
+        if (!memberLiteral || memberLiteral->value.type != PapyrusValueType::String)
           ctx->reportingContext.fatal(location, "Expected the literal name of the struct member as a string to compare against!");
 
-        auto memberName = args[0]->value->asLiteralExpression()->value.val.s;
+        auto memberName = memberLiteral->value.val.s;
         PapyrusType elemType = PapyrusType::Default();
         for (auto m : function.res.arrayFuncElementType->resolved.struc->members) {
           if (idEq(m->name, memberName)) {
@@ -300,6 +318,8 @@ void PapyrusFunctionCallExpression::semantic(PapyrusResolutionContext* ctx, Papy
     ctx->reportingContext.logicalFatal("Unknown PapyrusBuiltinArrayFunctionKind!");
   } else {
     assert(function.func != nullptr);
+    if (conf::General::wholeProgramAnalysis)
+      function.res.func->isCalled.store(true, std::memory_order_relaxed);
 
     if (function.res.func->returnType.isPoisoned(PapyrusType::PoisonKind::Beta)) {
       if (ctx->function == nullptr || !ctx->function->isBetaOnly()) {
@@ -380,7 +400,7 @@ void PapyrusFunctionCallExpression::semantic(PapyrusResolutionContext* ctx, Papy
         {
           bool isCustomEvent = p.other->type.type == PapyrusType::Kind::CustomEventName;
 
-          auto le = p.self->value->asLiteralExpression();
+          auto le = asWrittenLiteral(p.self->value);
           if (!le || le->value.type != PapyrusValueType::String) {
             ctx->reportingContext.error(p.self->value->location, "Argument %zu must be string literal.", p.other->index);
             continue;
@@ -425,7 +445,7 @@ void PapyrusFunctionCallExpression::semantic(PapyrusResolutionContext* ctx, Papy
     }
 
     if (function.res.func->name == "GotoState" && arguments.size() == 1) {
-      auto le = arguments.front()->value->asLiteralExpression();
+      auto le = asWrittenLiteral(arguments.front()->value);
       if (le && le->value.type == PapyrusValueType::String) {
         auto targetStateName = le->value.val.s;
         if (!ctx->tryResolveState(targetStateName))
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <common/CapricaConfig.h>
+
 #include <papyrus/PapyrusIdentifier.h>
+#include <papyrus/PapyrusProperty.h>
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 
 #include <pex/PexFile.h>
 #include <pex/PexFunctionBuilder.h>
@@ -19,6 +23,8 @@ struct PapyrusIdentifierExpression final : public PapyrusExpression
   virtual ~PapyrusIdentifierExpression() override = default;
 
   virtual pex::PexValue generateLoad(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override {
+    if (foldedValue)
+      return foldedValue->generateLoad(file, bldr);
     bldr << location;
     return identifier.generateLoad(file, bldr, pex::PexValue::Identifier(file->getString("self")));
   }
@@ -26,17 +32,47 @@ struct PapyrusIdentifierExpression final : public PapyrusExpression
   virtual void semantic(PapyrusResolutionContext* ctx) override {
     identifier = ctx->resolveIdentifier(identifier);
 
-    if (!isAssignmentContext)
+    if (!isAssignmentContext) {
       identifier.markRead();
+
+      // The getter of an AutoReadOnly property just returns its default
+      // value, so use that directly. This is only done for our own
+      // properties, as a parent's could change without us being
+      // recompiled.
+      if (conf::CodeGeneration::enableOptimizations && identifier.type == PapyrusIdentifierType::Property) {
+        auto prop = identifier.res.prop;
+        if (prop->isAutoReadOnly() && prop->parent == ctx->object) {
+          switch (prop->defaultValue.type) {
+            case PapyrusValueType::String:
+            case PapyrusValueType::Integer:
+            case PapyrusValueType::Float:
+            case PapyrusValueType::Bool:
+              foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, prop->defaultValue);
+              break;
+            default:
+              break;
+          }
+        }
+      }
+    }
   }
 
   virtual PapyrusType resultType() const override {
+    if (foldedValue)
+      return foldedValue->resultType();
     return identifier.resultType();
   }
 
   virtual PapyrusIdentifierExpression* asIdentifierExpression() override {
     return this;
   }
+
+  virtual PapyrusLiteralExpression* asLiteralExpression() override {
+    return foldedValue;
+  }
+
+private:
+  PapyrusLiteralExpression* foldedValue{ nullptr };
 };
 
 }}}
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
+#include <common/CapricaConfig.h>
+
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 
 #include <pex/PexFile.h>
 #include <pex/PexFunctionBuilder.h>
@@ -27,6 +32,8 @@ struct PapyrusUnaryOpExpression final : public PapyrusExpression
 
   virtual pex::PexValue generateLoad(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override {
     namespace op = caprica::pex::op;
+    if (foldedValue)
+      return foldedValue->generateLoad(file, bldr);
     auto iVal = innerExpression->generateLoad(file, bldr);
     auto dest = bldr.allocTemp(this->resultType());
     bldr << location;
@@ -53,13 +60,51 @@ struct PapyrusUnaryOpExpression final : public PapyrusExpression
     assert(operation != PapyrusUnaryOperatorType::None);
     innerExpression->semantic(ctx);
     ctx->checkForPoison(innerExpression);
+    if (conf::CodeGeneration::enableOptimizations)
+      tryFold(ctx);
   }
 
   virtual PapyrusType resultType() const override {
+    if (foldedValue)
+      return foldedValue->resultType();
     if (operation == PapyrusUnaryOperatorType::Not)
       return PapyrusType::Bool(location);
     return innerExpression->resultType();
   }
+
+  virtual PapyrusLiteralExpression* asLiteralExpression() override {
+    return foldedValue;
+  }
+
+private:
+  PapyrusLiteralExpression* foldedValue{ nullptr };
+
+  void tryFold(PapyrusResolutionContext* ctx) {
+    auto lit = innerExpression->asLiteralExpression();
+    if (!lit)
+      return;
+    auto& v = lit->value;
+    switch (operation) {
+      case PapyrusUnaryOperatorType::Negate:
+        if (v.type == PapyrusValueType::Integer)
+          foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, PapyrusValue::Integer(location, (int32_t)(0u - (uint32_t)v.val.i)));
+        else if (v.type == PapyrusValueType::Float)
+          foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, PapyrusValue::Float(location, -v.val.f));
+        return;
+      case PapyrusUnaryOperatorType::Not:
+        if (v.type == PapyrusValueType::Bool)
+          foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, PapyrusValue::Bool(location, !v.val.b));
+        else if (v.type == PapyrusValueType::Integer)
+          foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, PapyrusValue::Bool(location, v.val.i == 0));
+        else if (v.type == PapyrusValueType::Float)
+          foldedValue = ctx->allocator->make<PapyrusLiteralExpression>(location, PapyrusValue::Bool(location, v.val.f == 0.0f));
+        return;
+
+      case PapyrusUnaryOperatorType::None:
+        break;
+    }
+    CapricaReportingContext::logicalFatal("Unknown PapyrusUnaryOperatorType!");
+  }
 };
 
 }}}
@@ -3,6 +3,7 @@
 #include <common/IntrusiveLinkedList.h>
 
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 #include <papyrus/statements/PapyrusDeclareStatement.h>
 #include <papyrus/statements/PapyrusStatement.h>
 
@@ -52,9 +53,18 @@ struct PapyrusForStatement final : public PapyrusStatement
       iteratorVariable->generateStore(file, bldr, pex::PexValue::Identifier(file->getString("self")), iVal);
     }
     
+    // A step that was only folded to a literal 0 is checked at runtime,
+    // as it would be without optimizations, rather than being reported.
+    auto stepLiteral = stepValue ? stepValue->asLiteralExpression() : nullptr;
+    if (stepLiteral && stepLiteral != stepValue) {
+      if ((stepLiteral->value.type == PapyrusValueType::Integer && stepLiteral->value.val.i == 0) ||
+          (stepLiteral->value.type == PapyrusValueType::Float && stepLiteral->value.val.f == 0))
+        stepLiteral = nullptr;
+    }
+
     pex::PexLocalVariable* sValLoc{ nullptr };
     pex::PexValue sVal;
-    if (stepValue && !stepValue->asLiteralExpression()) {
+    if (stepValue && !stepLiteral) {
       auto stepValVal = stepValue->generateLoad(file, bldr);
       bldr << location;
       sValLoc = bldr.allocLongLivedTemp(initialValue->resultType());
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <common/CapricaConfig.h>
 #include <common/IntrusiveLinkedList.h>
 
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 #include <papyrus/statements/PapyrusStatement.h>
 
 #include <pex/PexFile.h>
@@ -31,6 +33,10 @@ struct PapyrusIfStatement final : public PapyrusStatement
   virtual ~PapyrusIfStatement() override = default;
 
   virtual bool buildCFG(PapyrusCFG& cfg) const override {
+    // Every branch may have been removed as dead.
+    if (!ifBodies.size() && !elseStatements.size())
+      return false;
+
     bool isTerminal = true;
 
     for (auto p : ifBodies) {
@@ -43,6 +49,8 @@ struct PapyrusIfStatement final : public PapyrusStatement
       isTerminal = cfg.processStatements(elseStatements) && isTerminal;
     }
 
+    if (isTerminal && !elseStatements.size())
+      cfg.markPossibleFallthrough();
     if (isTerminal)
       cfg.terminateNode(PapyrusControlFlowNodeEdgeType::Children);
     else
@@ -64,11 +72,16 @@ struct PapyrusIfStatement final : public PapyrusStatement
       bldr << op::jmpf{ lVal, nextCondition };
       for (auto s : ifBody->body)
         s->buildPex(file, bldr);
-      bldr << location;
-      bldr << op::jmp{ afterAll };
+      // With no else, the last branch would just be jumping to
+      // the next instruction.
+      if (!conf::CodeGeneration::enableOptimizations || ifBody != ifBodies.back() || elseStatements.size()) {
+        bldr << location;
+        bldr << op::jmp{ afterAll };
+      }
     }
 
-    bldr << nextCondition;
+    if (nextCondition)
+      bldr << nextCondition;
     for (auto s : elseStatements)
       s->buildPex(file, bldr);
     bldr << afterAll;
@@ -88,6 +101,9 @@ struct PapyrusIfStatement final : public PapyrusStatement
     for (auto s : elseStatements)
       s->semantic(ctx);
     ctx->popLocalVariableScope();
+
+    if (conf::CodeGeneration::enableOptimizations)
+      removeConstantBranches();
   }
 
   virtual void visit(PapyrusStatementVisitor& visitor) override {
@@ -100,6 +116,25 @@ struct PapyrusIfStatement final : public PapyrusStatement
     for (auto s : elseStatements)
       s->visit(visitor);
   }
+
+private:
+  // Drop the branches whose conditions are a literal False, and
+  // everything after the first branch with a literal True, which
+  // becomes the else.
+  void removeConstantBranches() {
+    IntrusiveLinkedList<IfBody> liveBodies{ };
+    while (ifBodies.size()) {
+      auto i = ifBodies.pop_front();
+      auto lit = i->condition->asLiteralExpression();
+      if (!lit || lit->value.type != PapyrusValueType::Bool) {
+        liveBodies.push_back(i);
+      } else if (lit->value.val.b) {
+        elseStatements = std::move(i->body);
+        break;
+      }
+    }
+    ifBodies = std::move(liveBodies);
+  }
 };
 
 }}}
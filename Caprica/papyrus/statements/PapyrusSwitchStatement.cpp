@@ -0,0 +1,190 @@
+#include <papyrus/statements/PapyrusSwitchStatement.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <common/CapricaConfig.h>
+
+namespace caprica { namespace papyrus { namespace statements {
+
+namespace {
+
+struct IntCase final
+{
+  int32_t value;
+  pex::PexLabel* label;
+};
+
+// With fewer cases than this, comparing against each in turn
+// is no slower than a decision tree.
+static constexpr size_t MinCasesForDecisionTree = 8;
+// Ranges of the tree this small are finished with a linear chain.
+static constexpr size_t MaxCasesPerLeaf = 3;
+
+// Binary search the sorted cases in [begin, end). lo and hi are the
+// bounds on the value already established by the comparisons above
+// this point, which lets dense ranges skip the final comparison.
+static void buildDecisionTree(pex::PexFunctionBuilder& bldr,
+                              const CapricaFileLocation& location,
+                              pex::PexLocalVariable* value,
+                              const std::vector<IntCase>& cases,
+                              size_t begin,
+                              size_t end,
+                              int64_t lo,
+                              int64_t hi,
+                              pex::PexLabel* defaultLabel) {
+  namespace op = caprica::pex::op;
+  if (end - begin <= MaxCasesPerLeaf) {
+    for (auto i = begin; i < end; i++) {
+      if (lo == hi) {
+        bldr << op::jmp{ cases[i].label };
+        return;
+      }
+      auto cond = bldr.allocTemp(PapyrusType::Bool(location));
+      bldr << op::cmpeq{ cond, value, pex::PexValue::Integer(cases[i].value) };
+      bldr << op::jmpt{ cond, cases[i].label };
+      if (cases[i].value == lo)
+        lo++;
+    }
+    bldr << op::jmp{ defaultLabel };
+    return;
+  }
+
+  auto mid = begin + (end - begin) / 2;
+  auto pivot = cases[mid].value;
+  pex::PexLabel* upperHalf;
+  bldr >> upperHalf;
+  auto cond = bldr.allocTemp(PapyrusType::Bool(location));
+  bldr << op::cmplt{ cond, value, pex::PexValue::Integer(pivot) };
+  bldr << op::jmpf{ cond, upperHalf };
+  buildDecisionTree(bldr, location, value, cases, begin, mid, lo, (int64_t)pivot - 1, defaultLabel);
+  bldr << upperHalf;
+  buildDecisionTree(bldr, location, value, cases, mid, end, pivot, hi, defaultLabel);
+}
+
+}
+
+void PapyrusSwitchStatement::buildPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const {
+  // String comparisons can only test for equality, so those
+  // are always a linear chain. The tree is larger, so cold
+  // functions keep the chain as well.
+  if (conf::CodeGeneration::enableOptimizations &&
+      bldr.hotness != CapricaProfileHotness::Cold &&
+      condition->resultType().type == PapyrusType::Kind::Int &&
+      caseBodies.size() >= MinCasesForDecisionTree) {
+    buildDecisionTreePex(file, bldr);
+  } else {
+    buildLinearPex(file, bldr);
+  }
+}
+
+void PapyrusSwitchStatement::buildLinearPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const {
+  namespace op = caprica::pex::op;
+
+  auto tmpDest = bldr.allocLongLivedTemp(condition->resultType());
+  bldr << location;
+  bldr << op::assign{ tmpDest, condition->generateLoad(file, bldr) };
+
+  pex::PexLabel* afterAll;
+  bldr >> afterAll;
+  bldr.pushBreakScope(afterAll);
+  pex::PexLabel* nextCondition{ nullptr };
+  for (auto& cBody : caseBodies) {
+    if (nextCondition)
+      bldr << nextCondition;
+    bldr >> nextCondition;
+    bldr << location;
+    auto cond = bldr.allocTemp(PapyrusType::Bool(location));
+    bldr << op::cmpeq{ cond, tmpDest, cBody->condition.buildPex(file) };
+    bldr << op::jmpf{ cond, nextCondition };
+    for (auto s : cBody->body)
+      s->buildPex(file, bldr);
+  }
+  bldr.freeLongLivedTemp(tmpDest);
+
+  bldr << nextCondition;
+  for (auto s : defaultStatements)
+    s->buildPex(file, bldr);
+  bldr.popBreakScope();
+  bldr << afterAll;
+}
+
+void PapyrusSwitchStatement::buildDecisionTreePex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const {
+  auto tmpDest = bldr.allocLongLivedTemp(condition->resultType());
+  bldr << location;
+  bldr << pex::op::assign{ tmpDest, condition->generateLoad(file, bldr) };
+
+  pex::PexLabel* afterAll;
+  bldr >> afterAll;
+  bldr.pushBreakScope(afterAll);
+  pex::PexLabel* defaultLabel;
+  bldr >> defaultLabel;
+
+  std::vector<pex::PexLabel*> labels{ };
+  std::vector<IntCase> cases{ };
+  labels.reserve(caseBodies.size());
+  cases.reserve(caseBodies.size());
+  for (auto& cBody : caseBodies) {
+    pex::PexLabel* lbl;
+    bldr >> lbl;
+    labels.push_back(lbl);
+    cases.push_back(IntCase{ cBody->condition.val.i, lbl });
+  }
+  std::stable_sort(cases.begin(), cases.end(), [](const IntCase& a, const IntCase& b) {
+    return a.value < b.value;
+  });
+  // Only the first of several cases with the same value could ever
+  // be reached by the linear chain, so drop the rest.
+  cases.erase(std::unique(cases.begin(), cases.end(), [](const IntCase& a, const IntCase& b) {
+    return a.value == b.value;
+  }), cases.end());
+
+  bldr << location;
+  buildDecisionTree(bldr,
+                    location,
+                    tmpDest,
+                    cases,
+                    0,
+                    cases.size(),
+                    std::numeric_limits<int32_t>::min(),
+                    std::numeric_limits<int32_t>::max(),
+                    defaultLabel);
+  bldr.freeLongLivedTemp(tmpDest);
+
+  // A case body can still reach its end, such as through an If
+  // without an Else, in which case the linear chain would go on to
+  // compare against the remaining cases. The value is known to be
+  // this case's, so that's the next case with the same value, or
+  // else the default. The jumps that are dead are left to the
+  // optimizer.
+  std::vector<int32_t> values{ };
+  values.reserve(caseBodies.size());
+  for (auto& cBody : caseBodies)
+    values.push_back(cBody->condition.val.i);
+  size_t i = 0;
+  for (auto& cBody : caseBodies) {
+    bldr << labels[i];
+    for (auto s : cBody->body)
+      s->buildPex(file, bldr);
+    auto continuation = defaultLabel;
+    for (auto j = i + 1; j < values.size(); j++) {
+      if (values[j] == values[i]) {
+        continuation = labels[j];
+        break;
+      }
+    }
+    bldr << location;
+    bldr << pex::op::jmp{ continuation };
+    i++;
+  }
+
+  bldr << defaultLabel;
+  for (auto s : defaultStatements)
+    s->buildPex(file, bldr);
+  bldr.popBreakScope();
+  bldr << afterAll;
+}
+
+}}}
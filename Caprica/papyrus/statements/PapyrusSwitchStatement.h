@@ -46,6 +46,10 @@ struct PapyrusSwitchStatement final : public PapyrusStatement
     }
 
     bool isTerminal = !cfg.popBreakTerminal();
+    // With no default, control continues after the switch if
+    // nothing matches.
+    if (isTerminal && !defaultStatements.size())
+      cfg.markPossibleFallthrough();
     if (isTerminal)
       cfg.terminateNode(PapyrusControlFlowNodeEdgeType::Children);
     else
@@ -53,36 +57,7 @@ struct PapyrusSwitchStatement final : public PapyrusStatement
     return isTerminal;
   }
 
-  virtual void buildPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override {
-    namespace op = caprica::pex::op;
-
-    auto tmpDest = bldr.allocLongLivedTemp(condition->resultType());
-    bldr << location;
-    bldr << op::assign{ tmpDest, condition->generateLoad(file, bldr) };
-
-    pex::PexLabel* afterAll;
-    bldr >> afterAll;
-    bldr.pushBreakScope(afterAll);
-    pex::PexLabel* nextCondition{ nullptr };
-    for (auto& cBody : caseBodies) {
-      if (nextCondition)
-        bldr << nextCondition;
-      bldr >> nextCondition;
-      bldr << location;
-      auto cond = bldr.allocTemp(PapyrusType::Bool(location));
-      bldr << op::cmpeq{ cond, tmpDest, cBody->condition.buildPex(file) };
-      bldr << op::jmpf{ cond, nextCondition };
-      for (auto s : cBody->body)
-        s->buildPex(file, bldr);
-    }
-    bldr.freeLongLivedTemp(tmpDest);
-
-    bldr << nextCondition;
-    for (auto s : defaultStatements)
-      s->buildPex(file, bldr);
-    bldr.popBreakScope();
-    bldr << afterAll;
-  }
+  virtual void buildPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override;
 
   virtual void semantic(PapyrusResolutionContext* ctx) override {
     condition->semantic(ctx);
@@ -116,6 +91,12 @@ struct PapyrusSwitchStatement final : public PapyrusStatement
     for (auto s : defaultStatements)
       s->visit(visitor);
   }
+
+private:
+  // Compare against each case in turn.
+  void buildLinearPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const;
+  // Binary search the Int cases, then emit the bodies.
+  void buildDecisionTreePex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const;
 };
 
 }}}
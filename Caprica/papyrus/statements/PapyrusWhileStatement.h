@@ -1,9 +1,11 @@
 #pragma once
 
+#include <common/CapricaConfig.h>
 #include <common/CapricaFileLocation.h>
 #include <common/IntrusiveLinkedList.h>
 
 #include <papyrus/expressions/PapyrusExpression.h>
+#include <papyrus/expressions/PapyrusLiteralExpression.h>
 #include <papyrus/statements/PapyrusStatement.h>
 
 #include <pex/PexFile.h>
@@ -21,11 +23,15 @@ struct PapyrusWhileStatement final : public PapyrusStatement
   virtual ~PapyrusWhileStatement() override = default;
 
   virtual bool buildCFG(PapyrusCFG& cfg) const override {
+    if (isNeverRun)
+      return false;
     return cfg.processCommonLoopBody(body);
   }
 
   virtual void buildPex(pex::PexFile* file, pex::PexFunctionBuilder& bldr) const override {
     namespace op = caprica::pex::op;
+    if (isNeverRun)
+      return;
     pex::PexLabel* beforeCondition;
     bldr >> beforeCondition;
     bldr << beforeCondition;
@@ -55,6 +61,11 @@ struct PapyrusWhileStatement final : public PapyrusStatement
       s->semantic(ctx);
     ctx->popLocalVariableScope();
     ctx->popBreakContinueScope();
+
+    if (conf::CodeGeneration::enableOptimizations) {
+      auto lit = condition->asLiteralExpression();
+      isNeverRun = lit && lit->value.type == PapyrusValueType::Bool && !lit->value.val.b;
+    }
   }
 
   virtual void visit(PapyrusStatementVisitor& visitor) override {
@@ -63,6 +74,11 @@ struct PapyrusWhileStatement final : public PapyrusStatement
     for (auto s : body)
       s->visit(visitor);
   }
+
+private:
+  // The condition is a literal False, so nothing needs to be
+  // generated for this loop at all.
+  bool isNeverRun{ false };
 };
 
 }}}
@@ -1,22 +1,24 @@
 #pragma once
 
+#include <charconv>
 #include <cstdint>
-#include <cstdio>
-#include <iostream>
-#include <memory>
-#include <sstream>
 #include <string>
+#include <type_traits>
+
+#include <common/identifier_ref.h>
 
 #include <pex/PexUserFlags.h>
 
 namespace caprica { namespace pex {
 
+// Formats Pex assembly into a buffer in memory, which is then
+// written out in one go once the whole file has been written.
 struct PexAsmWriter final
 {
   // The indent level. Yes, this spelling is deliberate.
   size_t ident{ 0 };
 
-  explicit PexAsmWriter(std::ostream& dest) : strm(dest) { }
+  PexAsmWriter() { buffer.reserve(1024 * 16); }
   PexAsmWriter(const PexAsmWriter&) = delete;
   ~PexAsmWriter() = default;
 
@@ -29,96 +31,116 @@ struct PexAsmWriter final
   void writeKV(const char* key, time_t val) {
     ensureIndent();
     // TODO: Add a comment output of the times in the local time.
-    strm << '.' << key << ' ' << (unsigned long long)val;
+    append('.', key, ' ', (unsigned long long)val);
     writeln();
   }
 
   template<>
-  void writeKV(const char* key, std::string val) {
+  void writeKV(const char* key, identifier_ref val) {
     ensureIndent();
-    strm << '.' << key << " \"" << escapeString(val) << "\"";
+    append('.', key, " \"");
+    appendEscaped(val);
+    append('"');
     writeln();
   }
 
   template<>
   void writeKV(const char* key, PexUserFlags val) {
     ensureIndent();
-    strm << '.' << key << " " << val.data;
+    append('.', key, ' ', val.data);
     writeln();
   }
 
+  // Write each of the arguments in turn. Strings are written as-is,
+  // and numbers are written in decimal, floats with 6 digits after
+  // the decimal point.
   template<typename... Args>
-  void write(const std::string& msg, Args&&... args) {
+  void write(const Args&... args) {
     ensureIndent();
-    strm << formatString(msg, args...);
+    append(args...);
   }
 
   template<typename... Args>
-  void writeln(const std::string& msg, Args&&... args) {
+  void writeln(const Args&... args) {
     ensureIndent();
-    strm << formatString(msg, args...);
+    append(args...);
     writeln();
   }
 
   void writeln() {
     haveIndented = false;
-    strm << std::endl;
+    buffer.push_back('\n');
+  }
+
+  // Write a string with the escapes the assembly parser expects,
+  // without the surrounding quotes.
+  void writeEscaped(identifier_ref str) {
+    ensureIndent();
+    appendEscaped(str);
+  }
+
+  const std::string& str() const { return buffer; }
+  size_t allocatedBytes() const { return buffer.capacity(); }
+
+private:
+  bool haveIndented{ false };
+  std::string buffer{ };
+
+  void ensureIndent() {
+    if (!haveIndented) {
+      buffer.append(ident * 2, ' ');
+      haveIndented = true;
+    }
+  }
+
+  void append() { }
+
+  template<typename T, typename... Rest>
+  void append(const T& val, const Rest&... rest) {
+    appendOne(val);
+    append(rest...);
+  }
+
+  void appendOne(char c) { buffer.push_back(c); }
+  void appendOne(const char* str) { buffer.append(str); }
+  void appendOne(identifier_ref str) { buffer.append(str.data(), str.size()); }
+  void appendOne(const std::string& str) { buffer.append(str); }
+
+  template<typename T>
+  std::enable_if_t<std::is_integral<T>::value> appendOne(T val) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val);
+    buffer.append(buf, res.ptr);
   }
 
-  static std::string escapeString(const std::string& str) {
-    std::ostringstream dest;
-    
+  void appendOne(float val) {
+    // The same as printf's %f. The largest float is 39 digits
+    // before the decimal point.
+    char buf[64];
+    auto res = std::to_chars(buf, buf + sizeof(buf), val, std::chars_format::fixed, 6);
+    buffer.append(buf, res.ptr);
+  }
+
+  void appendEscaped(identifier_ref str) {
     for (auto c : str) {
       switch (c) {
         case '\n':
-          dest.put('\\');
-          dest.put('n');
+          buffer.append("\\n");
           break;
         case '\t':
-          dest.put('\\');
-          dest.put('t');
+          buffer.append("\\t");
           break;
         case '"':
-          dest.put('\\');
-          dest.put('"');
+          buffer.append("\\\"");
           break;
         case '\\':
-          dest.put('\\');
-          dest.put('\\');
+          buffer.append("\\\\");
           break;
         default:
-          dest.put(c);
+          buffer.push_back(c);
           break;
       }
     }
-
-    return dest.str();
-  }
-
-private:
-  bool haveIndented{ false };
-  std::ostream& strm;
-
-  void ensureIndent() {
-    if (!haveIndented) {
-      for (size_t i = 0; i < ident; i++) {
-        strm << "  ";
-      }
-      haveIndented = true;
-    }
-  }
-
-  template<typename... Args>
-  static std::string formatString(const std::string& msg, Args&&... args) {
-    constexpr bool hasArgs = sizeof...(args) != 0;
-    if (hasArgs) {
-      size_t size = std::snprintf(nullptr, 0, msg.c_str(), args...) + 1;
-      std::unique_ptr<char[]> buf(new char[size]);
-      std::snprintf(buf.get(), size, msg.c_str(), args...);
-      return std::string(buf.get(), buf.get() + size - 1);
-    } else {
-      return msg;
-    }
   }
 };
 
@@ -0,0 +1,102 @@
+#include <pex/PexDebugLineMap.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <common/CapricaBinaryReader.h>
+
+namespace caprica { namespace pex {
+
+static constexpr uint32_t lineMapMagic = 0x4D4C5850; // 'PXLM'
+static constexpr uint32_t lineMapVersion = 1;
+
+static void writeVarint(CapricaBinaryWriter& wtr, uint32_t val) {
+  while (val >= 0x80) {
+    wtr.write<uint8_t>((uint8_t)(val | 0x80));
+    val >>= 7;
+  }
+  wtr.write<uint8_t>((uint8_t)val);
+}
+
+// Returns false if the data ends before the varint does, or it's
+// longer than any uint32 needs.
+static bool readVarint(CapricaBinaryReader& rdr, uint32_t& val) {
+  val = 0;
+  for (uint32_t shift = 0; shift < 35 && rdr.remaining(); shift += 7) {
+    auto b = rdr.read<uint8_t>();
+    val |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+void PexDebugLineMap::write(const PexFile* file, CapricaBinaryWriter& wtr) {
+  wtr.write<uint32_t>(lineMapMagic);
+  wtr.write<uint32_t>(lineMapVersion);
+  wtr.write<time_t>(file->compilationTime);
+  wtr.boundWrite<uint16_t>(file->debugInfo->functions.size());
+  for (auto f : file->debugInfo->functions) {
+    wtr.write<uint16_t>((uint16_t)f->objectName.index);
+    wtr.write<uint16_t>((uint16_t)f->stateName.index);
+    wtr.write<uint16_t>((uint16_t)f->functionName.index);
+    wtr.write<uint8_t>((uint8_t)f->functionType);
+    writeVarint(wtr, (uint32_t)f->instructionLineMap.size());
+    int32_t prevLine = 0;
+    for (auto l : f->instructionLineMap) {
+      // Lines almost always move by a little in either direction.
+      auto delta = (int32_t)l - prevLine;
+      writeVarint(wtr, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+      prevLine = l;
+    }
+  }
+}
+
+bool PexDebugLineMap::read(PexFile* file, std::string_view data) {
+  // A line map that's truncated or corrupt is ignored the same as
+  // one for a different compilation, rather than failing the file
+  // it was for, so everything is bounds-checked before it's read.
+  constexpr size_t headerSize = sizeof(uint32_t) * 2 + sizeof(time_t) + sizeof(uint16_t);
+  constexpr size_t functionHeaderSize = sizeof(uint16_t) * 3 + sizeof(uint8_t);
+  CapricaBinaryReader rdr{ data };
+  if (data.size() < headerSize ||
+      rdr.read<uint32_t>() != lineMapMagic ||
+      rdr.read<uint32_t>() != lineMapVersion ||
+      rdr.read<time_t>() != file->compilationTime) {
+    return false;
+  }
+
+  auto count = rdr.read<uint16_t>();
+  std::vector<PexDebugFunctionInfo*> functions{ };
+  functions.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (rdr.remaining() < functionHeaderSize)
+      return false;
+    auto f = file->alloc->make<PexDebugFunctionInfo>();
+    f->objectName.index = rdr.read<uint16_t>();
+    f->stateName.index = rdr.read<uint16_t>();
+    f->functionName.index = rdr.read<uint16_t>();
+    f->functionType = (PexDebugFunctionType)rdr.read<uint8_t>();
+    uint32_t lineCount;
+    // Each line takes at least a byte.
+    if (!readVarint(rdr, lineCount) || lineCount > rdr.remaining())
+      return false;
+    f->instructionLineMap.reserve(lineCount);
+    int32_t line = 0;
+    for (size_t l = 0; l < lineCount; l++) {
+      uint32_t zigzag;
+      if (!readVarint(rdr, zigzag))
+        return false;
+      line += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+      f->instructionLineMap.push_back((uint16_t)line);
+    }
+    functions.push_back(f);
+  }
+
+  file->ensureDebugInfo();
+  for (auto f : functions)
+    file->debugInfo->functions.push_back(f);
+  return true;
+}
+
+}}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+
+#include <common/CapricaBinaryWriter.h>
+
+#include <pex/PexFile.h>
+
+namespace caprica { namespace pex {
+
+// The line maps of a Pex file's debug info, split out into a file of
+// their own, so that the Pex file shipped only needs the property
+// groups and struct orders that the Creation Kit uses, while a
+// debugger can still map instructions back to lines.
+//
+// Names are stored as indexes into the Pex file's string table, so
+// the line map is only valid alongside the Pex file it was split from,
+// which is checked by the compilation time. Everything is
+// little-endian, and the layout is:
+//   uint32 magic ('PXLM'), uint32 version, time_t compilation time,
+//   uint16 function count, then for each function:
+//     uint16 object, state, and function name, uint8 function type,
+//     the instruction count as a varint, then the line of each
+//     instruction as the zigzag varint of its difference from the
+//     line before it.
+struct PexDebugLineMap final
+{
+  static constexpr const char* extension = ".pexlines";
+
+  // Write the line maps of the file's debug info.
+  static void write(const PexFile* file, CapricaBinaryWriter& wtr);
+  // Restore line maps written by write() to the file's debug info.
+  // Returns false, leaving the file as it was, if they weren't
+  // written for this file, or the data is truncated or corrupt.
+  static bool read(PexFile* file, std::string_view data);
+};
+
+}}
@@ -27,13 +27,13 @@ void PexDebugPropertyGroup::write(PexWriter& wtr) const {
 }
 
 void PexDebugPropertyGroup::writeAsm(const PexFile* file, PexAsmWriter& wtr) const {
-  wtr.writeln(".propertyGroup %s", file->getStringValue(groupName).to_string().c_str());
+  wtr.writeln(".propertyGroup ", file->getStringValue(groupName));
   wtr.ident++;
 
   wtr.writeKV<PexUserFlags>("userFlags", userFlags);
-  wtr.writeKV<std::string>("docString", file->getStringValue(documentationString).to_string());
+  wtr.writeKV<identifier_ref>("docString", file->getStringValue(documentationString));
   for (auto p : properties)
-    wtr.writeln(".property %s", file->getStringValue(*p).to_string().c_str());
+    wtr.writeln(".property ", file->getStringValue(*p));
 
   wtr.ident--;
   wtr.writeln(".endPropertyGroup");
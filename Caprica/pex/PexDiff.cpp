@@ -0,0 +1,396 @@
+#include <pex/PexDiff.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <common/CapricaReportingContext.h>
+#include <common/CaselessStringComparer.h>
+#include <common/FSUtils.h>
+#include <common/allocators/ChainedPool.h>
+
+#include <pex/PexFile.h>
+#include <pex/PexReader.h>
+
+namespace filesystem = std::experimental::filesystem;
+
+namespace caprica { namespace pex {
+
+namespace {
+
+struct LoadedFile final
+{
+  // The string table refers into this, so it has to
+  // outlive the file.
+  std::string data{ };
+  PexFile* file{ nullptr };
+  size_t instructionCount{ 0 };
+  // Keyed by `Object.State.Function`, or `Object.Function` in
+  // the empty state, and `Object.Property.Get` or `.Set` for
+  // property functions.
+  std::vector<std::pair<std::string, const PexFunction*>> functions{ };
+
+  LoadedFile() = default;
+  LoadedFile(const LoadedFile&) = delete;
+  ~LoadedFile() {
+    if (file)
+      delete file->alloc;
+  }
+
+  bool load(const std::string& path);
+};
+
+struct FileDiffJob final : public CapricaJob
+{
+  std::string relativePath{ };
+  // Empty if the file isn't in that tree.
+  std::string oldPath{ };
+  std::string newPath{ };
+
+  bool failed{ false };
+  bool changed{ false };
+  size_t oldSize{ 0 };
+  size_t newSize{ 0 };
+  size_t oldInstructions{ 0 };
+  size_t newInstructions{ 0 };
+  // What changed, one line each.
+  std::vector<std::string> details{ };
+
+  virtual void run() override;
+};
+
+}
+
+bool LoadedFile::load(const std::string& path) {
+  std::ifstream strm{ path, std::ifstream::binary };
+  if (!strm.is_open())
+    return false;
+  std::stringstream contents{ };
+  contents << strm.rdbuf();
+  data = contents.str();
+
+  PexReader rdr{ data };
+  auto alloc = new allocators::ChainedPool(1024 * 4);
+  try {
+    file = PexFile::read(alloc, rdr);
+  } catch (...) {
+    delete alloc;
+    throw;
+  }
+
+  for (auto o : file->objects) {
+    auto objectName = file->getStringValue(o->name).to_string();
+    for (auto s : o->states) {
+      auto stateName = file->getStringValue(s->name);
+      for (auto f : s->functions) {
+        auto key = objectName + ".";
+        if (stateName.size())
+          key += stateName.to_string() + ".";
+        functions.emplace_back(key + file->getStringValue(f->name).to_string(), f);
+      }
+    }
+    for (auto p : o->properties) {
+      auto key = objectName + "." + file->getStringValue(p->name).to_string();
+      if (p->readFunction)
+        functions.emplace_back(key + ".Get", p->readFunction);
+      if (p->writeFunction)
+        functions.emplace_back(key + ".Set", p->writeFunction);
+    }
+  }
+  for (auto& f : functions)
+    instructionCount += f.second->instructions.size();
+  return true;
+}
+
+static bool valuesMatch(const PexFile* a, const PexValue& va, const PexFile* b, const PexValue& vb) {
+  if (va.type != vb.type)
+    return false;
+  switch (va.type) {
+    case PexValueType::None:
+      return true;
+    case PexValueType::Identifier:
+      return idEq(a->getStringValue(va.val.s), b->getStringValue(vb.val.s));
+    case PexValueType::String:
+      return a->getStringValue(va.val.s).equals(b->getStringValue(vb.val.s));
+    case PexValueType::Integer:
+      return va.val.i == vb.val.i;
+    case PexValueType::Float:
+      return va.val.f == vb.val.f;
+    case PexValueType::Bool:
+      return va.val.b == vb.val.b;
+    case PexValueType::Label:
+    case PexValueType::TemporaryVar:
+    case PexValueType::Invalid:
+      break;
+  }
+  CapricaReportingContext::logicalFatal("Unexpected PexValueType in a Pex file that was read!");
+}
+
+static bool namesMatch(const PexFile* a, PexString sa, const PexFile* b, PexString sb) {
+  return idEq(a->getStringValue(sa), b->getStringValue(sb));
+}
+
+static bool stringsMatch(const PexFile* a, PexString sa, const PexFile* b, PexString sb) {
+  return a->getStringValue(sa).equals(b->getStringValue(sb));
+}
+
+// Match the members of two lists by name, regardless of order.
+template<typename T, typename F>
+static bool membersMatch(const PexFile* a, const IntrusiveLinkedList<T>& as, const PexFile* b, const IntrusiveLinkedList<T>& bs, F matches) {
+  if (as.size() != bs.size())
+    return false;
+  caseless_unordered_identifier_ref_map<const T*> byName{ };
+  for (auto m : bs)
+    byName.emplace(b->getStringValue(m->name), m);
+  for (auto m : as) {
+    auto f = byName.find(a->getStringValue(m->name));
+    if (f == byName.end() || !matches(m, f->second))
+      return false;
+  }
+  return true;
+}
+
+// The locals aren't compared, as a change to them that matters
+// shows up in the instructions.
+static bool functionsMatch(const PexFile* a, const PexFunction* fa, const PexFile* b, const PexFunction* fb) {
+  if (fa->isNative != fb->isNative ||
+      fa->isGlobal != fb->isGlobal ||
+      fa->userFlags.data != fb->userFlags.data ||
+      !namesMatch(a, fa->returnTypeName, b, fb->returnTypeName) ||
+      !stringsMatch(a, fa->documentationString, b, fb->documentationString) ||
+      fa->parameters.size() != fb->parameters.size() ||
+      fa->instructions.size() != fb->instructions.size()) {
+    return false;
+  }
+
+  for (auto pa = fa->parameters.begin(), pb = fb->parameters.begin(); pa != fa->parameters.end(); ++pa, ++pb) {
+    if (!namesMatch(a, pa->name, b, pb->name) || !namesMatch(a, pa->type, b, pb->type))
+      return false;
+  }
+
+  for (auto ia = fa->instructions.begin(), ib = fb->instructions.begin(); ia != fa->instructions.end(); ++ia, ++ib) {
+    if (ia->opCode != ib->opCode || ia->args.size() != ib->args.size() || ia->variadicArgs.size() != ib->variadicArgs.size())
+      return false;
+    for (size_t i = 0; i < ia->args.size(); i++) {
+      if (!valuesMatch(a, ia->args[i], b, ib->args[i]))
+        return false;
+    }
+    for (auto va = ia->variadicArgs.begin(), vb = ib->variadicArgs.begin(); va != ia->variadicArgs.end(); ++va, ++vb) {
+      if (!valuesMatch(a, **va, b, **vb))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Everything about the object other than the code.
+static bool declarationsMatch(const PexFile* a, const PexObject* oa, const PexFile* b, const PexObject* ob) {
+  if (oa->isConst != ob->isConst ||
+      oa->userFlags.data != ob->userFlags.data ||
+      !namesMatch(a, oa->parentClassName, b, ob->parentClassName) ||
+      !namesMatch(a, oa->autoStateName, b, ob->autoStateName) ||
+      !stringsMatch(a, oa->documentationString, b, ob->documentationString)) {
+    return false;
+  }
+
+  if (!membersMatch(a, oa->variables, b, ob->variables, [&](const PexVariable* va, const PexVariable* vb) {
+    return va->isConst == vb->isConst &&
+           va->userFlags.data == vb->userFlags.data &&
+           namesMatch(a, va->typeName, b, vb->typeName) &&
+           valuesMatch(a, va->defaultValue, b, vb->defaultValue);
+  })) {
+    return false;
+  }
+
+  if (!membersMatch(a, oa->properties, b, ob->properties, [&](const PexProperty* pa, const PexProperty* pb) {
+    return pa->isAuto == pb->isAuto &&
+           pa->isReadable == pb->isReadable &&
+           pa->isWritable == pb->isWritable &&
+           pa->userFlags.data == pb->userFlags.data &&
+           namesMatch(a, pa->typeName, b, pb->typeName) &&
+           namesMatch(a, pa->autoVar, b, pb->autoVar) &&
+           stringsMatch(a, pa->documentationString, b, pb->documentationString);
+  })) {
+    return false;
+  }
+
+  return membersMatch(a, oa->structs, b, ob->structs, [&](const PexStruct* sa, const PexStruct* sb) {
+    return membersMatch(a, sa->members, b, sb->members, [&](const PexStructMember* ma, const PexStructMember* mb) {
+      return ma->isConst == mb->isConst &&
+             ma->userFlags.data == mb->userFlags.data &&
+             namesMatch(a, ma->typeName, b, mb->typeName) &&
+             valuesMatch(a, ma->defaultValue, b, mb->defaultValue) &&
+             stringsMatch(a, ma->documentationString, b, mb->documentationString);
+    });
+  });
+}
+
+void FileDiffJob::run() {
+  LoadedFile oldFile{ };
+  LoadedFile newFile{ };
+  // A file that isn't a valid Pex file is reported as unreadable,
+  // rather than stopping the rest of the diff.
+  try {
+    if ((oldPath != "" && !oldFile.load(oldPath)) || (newPath != "" && !newFile.load(newPath))) {
+      failed = true;
+      return;
+    }
+  } catch (const std::runtime_error&) {
+    failed = true;
+    return;
+  }
+  oldSize = oldFile.data.size();
+  newSize = newFile.data.size();
+  oldInstructions = oldFile.instructionCount;
+  newInstructions = newFile.instructionCount;
+  if (oldPath == "" || newPath == "")
+    return;
+
+  auto a = oldFile.file;
+  auto b = newFile.file;
+  if (a->majorVersion != b->majorVersion || a->minorVersion != b->minorVersion || a->gameID != b->gameID)
+    details.push_back("Changed the Pex version or game");
+
+  caseless_unordered_identifier_ref_map<const PexObject*> oldObjects{ };
+  for (auto o : a->objects)
+    oldObjects.emplace(a->getStringValue(o->name), o);
+  caseless_unordered_identifier_ref_set newObjectNames{ };
+  for (auto o : b->objects) {
+    auto name = b->getStringValue(o->name);
+    newObjectNames.insert(name);
+    auto f = oldObjects.find(name);
+    if (f == oldObjects.end())
+      details.push_back("Added object " + name.to_string());
+    else if (!declarationsMatch(a, f->second, b, o))
+      details.push_back("Changed the declarations of " + name.to_string());
+  }
+  for (auto o : a->objects) {
+    if (!newObjectNames.count(a->getStringValue(o->name)))
+      details.push_back("Removed object " + a->getStringValue(o->name).to_string());
+  }
+
+  caseless_unordered_identifier_map<const PexFunction*> oldFunctions{ };
+  for (auto& f : oldFile.functions)
+    oldFunctions.emplace(f.first, f.second);
+  caseless_unordered_identifier_set newFunctionNames{ };
+  for (auto& f : newFile.functions) {
+    newFunctionNames.insert(f.first);
+    auto old = oldFunctions.find(f.first);
+    if (old == oldFunctions.end()) {
+      details.push_back("Added " + f.first);
+    } else if (!functionsMatch(a, old->second, b, f.second)) {
+      details.push_back("Changed " + f.first + ": " + std::to_string(old->second->instructions.size()) + " -> " +
+                        std::to_string(f.second->instructions.size()) + " instructions");
+    }
+  }
+  for (auto& f : oldFile.functions) {
+    if (!newFunctionNames.count(f.first))
+      details.push_back("Removed " + f.first);
+  }
+
+  changed = details.size() != 0;
+}
+
+static bool collectPexFiles(const std::string& directory, caseless_unordered_path_map<std::string>& files) {
+  if (!filesystem::is_directory(directory)) {
+    std::cout << "Unable to find the directory '" << directory << "'!" << std::endl;
+    return false;
+  }
+  auto baseDir = FSUtils::canonical(directory);
+  for (auto& e : filesystem::recursive_directory_iterator(baseDir)) {
+    if (!filesystem::is_regular_file(e.status()))
+      continue;
+    auto path = e.path().string();
+    if (pathEq(FSUtils::extensionAsRef(path), ".pex"))
+      files.emplace(path.substr(baseDir.size() + 1), path);
+  }
+  return true;
+}
+
+static std::string formatDelta(size_t before, size_t after) {
+  if (after >= before)
+    return "+" + std::to_string(after - before);
+  return "-" + std::to_string(before - after);
+}
+
+bool PexDiff::diffDirectories(CapricaJobManager* jobManager, const std::string& oldDirectory, const std::string& newDirectory) {
+  caseless_unordered_path_map<std::string> oldFiles{ };
+  caseless_unordered_path_map<std::string> newFiles{ };
+  if (!collectPexFiles(oldDirectory, oldFiles) || !collectPexFiles(newDirectory, newFiles))
+    return false;
+
+  std::vector<std::unique_ptr<FileDiffJob>> jobs{ };
+  jobs.reserve(std::max(oldFiles.size(), newFiles.size()));
+  for (auto& f : newFiles) {
+    auto job = std::make_unique<FileDiffJob>();
+    job->relativePath = f.first;
+    job->newPath = f.second;
+    auto old = oldFiles.find(f.first);
+    if (old != oldFiles.end())
+      job->oldPath = old->second;
+    jobs.push_back(std::move(job));
+  }
+  for (auto& f : oldFiles) {
+    if (!newFiles.count(f.first)) {
+      auto job = std::make_unique<FileDiffJob>();
+      job->relativePath = f.first;
+      job->oldPath = f.second;
+      jobs.push_back(std::move(job));
+    }
+  }
+  std::sort(jobs.begin(), jobs.end(), [](const std::unique_ptr<FileDiffJob>& a, const std::unique_ptr<FileDiffJob>& b) {
+    return _stricmp(a->relativePath.c_str(), b->relativePath.c_str()) < 0;
+  });
+
+  for (auto& j : jobs)
+    jobManager->queueJob(j.get());
+  jobManager->setQueueInitialized();
+  jobManager->enjoin();
+
+  size_t changedCount = 0, addedCount = 0, removedCount = 0, failedCount = 0;
+  size_t oldInstructions = 0, newInstructions = 0, oldSize = 0, newSize = 0;
+  for (auto& j : jobs) {
+    j->await();
+    if (j->failed) {
+      std::cout << "Unable to read " << j->relativePath << std::endl;
+      failedCount++;
+      continue;
+    }
+    oldInstructions += j->oldInstructions;
+    newInstructions += j->newInstructions;
+    oldSize += j->oldSize;
+    newSize += j->newSize;
+
+    if (j->oldPath == "") {
+      std::cout << "Added " << j->relativePath << ": " << j->newInstructions << " instructions, " << j->newSize << " bytes" << std::endl;
+      addedCount++;
+    } else if (j->newPath == "") {
+      std::cout << "Removed " << j->relativePath << ": " << j->oldInstructions << " instructions, " << j->oldSize << " bytes" << std::endl;
+      removedCount++;
+    } else if (j->changed) {
+      std::cout << "Changed " << j->relativePath << ": "
+                << j->oldInstructions << " -> " << j->newInstructions << " instructions (" << formatDelta(j->oldInstructions, j->newInstructions) << "), "
+                << j->oldSize << " -> " << j->newSize << " bytes (" << formatDelta(j->oldSize, j->newSize) << ")" << std::endl;
+      for (auto& d : j->details)
+        std::cout << "  " << d << std::endl;
+      changedCount++;
+    }
+  }
+
+  std::cout << "Compared " << jobs.size() << " files: "
+            << changedCount << " changed, " << addedCount << " added, " << removedCount << " removed, "
+            << (jobs.size() - changedCount - addedCount - removedCount - failedCount) << " unchanged";
+  if (failedCount)
+    std::cout << ", " << failedCount << " unreadable";
+  std::cout << "." << std::endl;
+  std::cout << "In total: " << oldInstructions << " -> " << newInstructions << " instructions (" << formatDelta(oldInstructions, newInstructions) << "), "
+            << oldSize << " -> " << newSize << " bytes (" << formatDelta(oldSize, newSize) << ")" << std::endl;
+  return true;
+}
+
+}}
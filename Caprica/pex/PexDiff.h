@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include <common/CapricaJobManager.h>
+
+namespace caprica { namespace pex {
+
+// Compares two trees of compiled Pex files, such as the output of
+// the same scripts before and after changing the compiler options.
+//
+// Files are matched by their path relative to each directory, and
+// compared by what they contain rather than byte by byte, so that
+// the timestamps, the user and computer names, the order of the
+// string table, and the debug info don't count as changes.
+struct PexDiff final
+{
+  // Read and compare the files on the job manager's workers, then
+  // print the files that changed, were added, or were removed,
+  // along with the change in their instruction counts and sizes.
+  // Returns false, after reporting why, if either directory
+  // couldn't be read.
+  static bool diffDirectories(CapricaJobManager* jobManager, const std::string& oldDirectory, const std::string& newDirectory);
+};
+
+}}
@@ -93,10 +93,8 @@ PexFile* PexFile::read(allocators::ChainedPool* alloc, PexReader& rdr) {
   file->computerName = rdr.read<std::string>();
 
   auto strTableSize = rdr.read<uint16_t>();
-  for (size_t i = 0; i < strTableSize; i++) {
-    auto str = rdr.read<std::string>();
-    file->stringTable->push_back(str);
-  }
+  for (size_t i = 0; i < strTableSize; i++)
+    file->stringTable->push_back_ref(rdr.read<identifier_ref>());
 
   if (rdr.read<uint8_t>() != 0)
     file->debugInfo = PexDebugInfo::read(alloc, rdr);
@@ -117,6 +115,108 @@ PexFile* PexFile::read(allocators::ChainedPool* alloc, PexReader& rdr) {
   return file;
 }
 
+// These mirror the write functions of each type, and must be kept
+// in sync with them for the output to be written in one buffer.
+static constexpr size_t stringSize = sizeof(uint16_t);
+static constexpr size_t userFlagsSize = sizeof(uint32_t);
+static constexpr size_t countSize = sizeof(uint16_t);
+
+static size_t valueSize(const PexValue& val) {
+  switch (val.type) {
+    case PexValueType::Identifier:
+    case PexValueType::String:
+      return 1 + stringSize;
+    case PexValueType::Integer:
+    case PexValueType::Float:
+      return 1 + sizeof(uint32_t);
+    case PexValueType::Bool:
+      return 1 + sizeof(uint8_t);
+    default:
+      return 1;
+  }
+}
+
+static size_t functionSize(const PexFunction* func) {
+  size_t size = (func->name.valid() ? stringSize : 0) + stringSize * 2 + userFlagsSize + 1;
+  size += countSize + func->parameters.size() * stringSize * 2;
+  size += countSize + func->locals.size() * stringSize * 2;
+  size += countSize;
+  for (auto i : func->instructions) {
+    size += 1;
+    for (auto& a : i->args)
+      size += valueSize(a);
+    switch (i->opCode) {
+      case PexOpCode::CallMethod:
+      case PexOpCode::CallParent:
+      case PexOpCode::CallStatic:
+        size += 1 + sizeof(uint32_t);
+        for (auto v : i->variadicArgs)
+          size += valueSize(*v);
+        break;
+      default:
+        break;
+    }
+  }
+  return size;
+}
+
+size_t PexFile::writeSize() const {
+  size_t size = sizeof(uint32_t) + 2 + sizeof(uint16_t) + sizeof(time_t);
+  size += 3 * sizeof(uint16_t) + sourceFileName.size() + userName.size() + computerName.size();
+  size += countSize;
+  for (size_t i = 0; i < stringTable->size(); i++)
+    size += sizeof(uint16_t) + stringTable->byIndex(i).size();
+
+  size += 1;
+  if (debugInfo) {
+    size += sizeof(time_t);
+    size += countSize;
+    for (auto f : debugInfo->functions)
+      size += stringSize * 3 + 1 + countSize + f->instructionLineMap.size() * sizeof(uint16_t);
+    size += countSize;
+    for (auto p : debugInfo->propertyGroups)
+      size += stringSize * 3 + userFlagsSize + countSize + p->properties.size() * stringSize;
+    size += countSize;
+    for (auto s : debugInfo->structOrders)
+      size += stringSize * 2 + countSize + s->members.size() * stringSize;
+  }
+
+  size += countSize + userFlagTable.size() * (stringSize + 1);
+
+  size += countSize;
+  for (auto o : objects) {
+    size += stringSize + sizeof(uint32_t) + stringSize * 2 + 1 + userFlagsSize + stringSize;
+    size += countSize;
+    for (auto s : o->structs) {
+      size += stringSize + countSize;
+      for (auto m : s->members)
+        size += stringSize * 2 + userFlagsSize + valueSize(m->defaultValue) + 1 + stringSize;
+    }
+    size += countSize;
+    for (auto v : o->variables)
+      size += stringSize * 2 + userFlagsSize + valueSize(v->defaultValue) + 1;
+    size += countSize;
+    for (auto p : o->properties) {
+      size += stringSize * 3 + userFlagsSize + 1;
+      if (p->isAuto) {
+        size += stringSize;
+      } else {
+        if (p->isReadable)
+          size += functionSize(p->readFunction);
+        if (p->isWritable)
+          size += functionSize(p->writeFunction);
+      }
+    }
+    size += countSize;
+    for (auto s : o->states) {
+      size += stringSize + countSize;
+      for (auto f : s->functions)
+        size += functionSize(f);
+    }
+  }
+  return size;
+}
+
 void PexFile::write(PexWriter& wtr) const {
   wtr.write<uint32_t>(0xFA57C0DE); // Magic Number
   wtr.write<uint8_t>(majorVersion);
@@ -152,21 +252,21 @@ void PexFile::write(PexWriter& wtr) const {
 void PexFile::writeAsm(PexAsmWriter& wtr) const {
   wtr.writeln(".info");
   wtr.ident++;
-  wtr.writeKV<std::string>("source", sourceFileName);
+  wtr.writeKV<identifier_ref>("source", sourceFileName);
   if (debugInfo)
     wtr.writeKV<time_t>("modifyTime", debugInfo->modificationTime);
   else
     wtr.writeln(".modifyTime 0 ;Debug info: No");
   wtr.writeKV<time_t>("compileTime", compilationTime);
-  wtr.writeKV<std::string>("user", userName);
-  wtr.writeKV<std::string>("computer", computerName);
+  wtr.writeKV<identifier_ref>("user", userName);
+  wtr.writeKV<identifier_ref>("computer", computerName);
   wtr.ident--;
   wtr.writeln(".endInfo");
 
   wtr.writeln(".userFlagsRef");
   wtr.ident++;
   for (auto a : userFlagTable)
-    wtr.writeln(".flag %s %u", getStringValue(a.first).to_string().c_str(), (unsigned)a.second);
+    wtr.writeln(".flag ", getStringValue(a.first), ' ', (unsigned)a.second);
   wtr.ident--;
   wtr.writeln(".endUserFlagsRef");
 
@@ -62,7 +62,12 @@ struct PexFile final
   PexUserFlags getUserFlag(PexString name, uint8_t bitNum);
   size_t getUserFlagCount() const noexcept;
 
+  // The string table refers into the data being read, so
+  // that must outlive the file.
   static PexFile* read(allocators::ChainedPool* alloc, PexReader& rdr);
+  // The exact number of bytes write() will produce, so
+  // that the writer can be sized up front.
+  size_t writeSize() const;
   void write(PexWriter& wtr) const;
   void writeAsm(PexAsmWriter& wtr) const;
 
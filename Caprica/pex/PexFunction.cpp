@@ -65,7 +65,7 @@ void PexFunction::writeAsm(const PexFile* file, const PexObject* obj, const PexS
   else if (funcType == PexDebugFunctionType::Setter)
     wtr.write("set");
   else
-    wtr.write(file->getStringValue(name).to_string().c_str());
+    wtr.write(file->getStringValue(name));
 
   if (isNative)
     wtr.write(" native");
@@ -76,8 +76,8 @@ void PexFunction::writeAsm(const PexFile* file, const PexObject* obj, const PexS
   wtr.ident++;
 
   wtr.writeKV<PexUserFlags>("userFlags", userFlags);
-  wtr.writeKV<std::string>("docString", file->getStringValue(documentationString).to_string());
-  wtr.writeln(".return %s", file->getStringValue(returnTypeName).to_string().c_str());
+  wtr.writeKV<identifier_ref>("docString", file->getStringValue(documentationString));
+  wtr.writeln(".return ", file->getStringValue(returnTypeName));
 
   wtr.writeln(".paramTable");
   wtr.ident++;
@@ -112,17 +112,17 @@ void PexFunction::writeAsm(const PexFile* file, const PexObject* obj, const PexS
     for (auto cur = instructions.begin(), end = instructions.end(); cur != end; ++cur) {
       auto f = labelMap.find(cur.index);
       if (f != labelMap.end()) {
-        wtr.writeln("label%llu:", f->second);
+        wtr.writeln("label", f->second, ':');
       }
 
       wtr.write(PexInstruction::opCodeToPexAsm(cur->opCode));
 
       if (cur->opCode == PexOpCode::Jmp) {
-        wtr.write(" label%llu", labelMap[(size_t)(cur->args[0].val.i + cur.index)]);
+        wtr.write(" label", labelMap[(size_t)(cur->args[0].val.i + cur.index)]);
       } else if (cur->opCode == PexOpCode::JmpT || cur->opCode == PexOpCode::JmpF) {
         wtr.write(" ");
         cur->args[0].writeAsm(file, wtr);
-        wtr.write(" label%llu", labelMap[(size_t)(cur->args[1].val.i + cur.index)]);
+        wtr.write(" label", labelMap[(size_t)(cur->args[1].val.i + cur.index)]);
       } else {
         for (auto& a : cur->args) {
           wtr.write(" ");
@@ -135,7 +135,7 @@ void PexFunction::writeAsm(const PexFile* file, const PexObject* obj, const PexS
       }
 
       if (debInf && cur.index < debInf->instructionLineMap.size()) {
-        wtr.write(" ;@line %u", debInf->instructionLineMap[cur.index]);
+        wtr.write(" ;@line ", debInf->instructionLineMap[cur.index]);
       }
 
       wtr.writeln();
@@ -143,7 +143,7 @@ void PexFunction::writeAsm(const PexFile* file, const PexObject* obj, const PexS
 
     auto f = labelMap.find(instructions.size());
     if (f != labelMap.end()) {
-      wtr.writeln("label%llu:", f->second);
+      wtr.writeln("label", f->second, ':');
     }
 
     wtr.ident--;
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include <common/CapricaProfile.h>
 #include <common/IntrusiveLinkedList.h>
 
 #include <pex/PexAsmWriter.h>
@@ -31,6 +32,9 @@ struct PexFunction final
   PexUserFlags userFlags{ };
   bool isNative{ false };
   bool isGlobal{ false };
+  // Only known when compiling with a profile. This isn't
+  // part of the Pex file.
+  CapricaProfileHotness hotness{ CapricaProfileHotness::Unknown };
   IntrusiveLinkedList<PexFunctionParameter> parameters{ };
   IntrusiveLinkedList<PexLocalVariable> locals{ };
   IntrusiveLinkedList<PexInstruction> instructions{ };
@@ -1,8 +1,11 @@
 #include <pex/PexFunctionBuilder.h>
 
+#include <common/CapricaConfig.h>
 #include <common/CapricaReportingContext.h>
 #include <common/allocators/CachePool.h>
 
+#include <pex/PexOptimizationRemarks.h>
+
 namespace caprica { namespace pex {
 
 static thread_local allocators::CachePool<FixedPexStringMap<detail::TempVarDescriptor>> stringMapCache{ };
@@ -34,15 +37,36 @@ void PexFunctionBuilder::populateFunction(PexFunction* func, PexDebugFunctionInf
       CapricaReportingContext::logicalFatal("Unresolved tmp var!");
   }
 
+  if (conf::CodeGeneration::enableOptimizations) {
+    auto tempsBefore = debInfo && PexOptimizationRemarks::enabled() ? PexOptimizationRemarks::countTemps(file, locals) : 0;
+    coalesceTempVars();
+    if (debInfo && PexOptimizationRemarks::enabled()) {
+      auto tempsAfter = PexOptimizationRemarks::countTemps(file, locals);
+      if (tempsAfter != tempsBefore) {
+        PexOptimizationRemarks::Function remarkFunction{ };
+        remarkFunction.objectName = file->getStringValue(debInfo->objectName);
+        remarkFunction.stateName = file->getStringValue(debInfo->stateName);
+        remarkFunction.functionName = file->getStringValue(debInfo->functionName);
+        remarkFunction.functionType = debInfo->functionType;
+        auto firstLocation = instructionLocations.begin();
+        if (firstLocation != instructionLocations.end())
+          remarkFunction.line = reportingContext.getLocationLine(*firstLocation);
+        PexOptimizationRemarks::emit(remarkFunction, "coalesce-temps", instructions.size(), instructions.size(), tempsBefore, tempsAfter);
+      }
+    }
+  }
+
   func->instructions = std::move(instructions);
   func->locals = std::move(locals);
-  debInfo->instructionLineMap.reserve(func->instructions.size());
-  size_t line = 0;
-  for (auto l : instructionLocations) {
-    line = reportingContext.getLocationLine(l, line);
-    if (line > std::numeric_limits<uint16_t>::max())
-      reportingContext.fatal(l, "The file has too many lines for the debug info to be able to map correctly!");
-    debInfo->instructionLineMap.emplace_back((uint16_t)line);
+  if (debInfo) {
+    debInfo->instructionLineMap.reserve(func->instructions.size());
+    size_t line = 0;
+    for (auto l : instructionLocations) {
+      line = reportingContext.getLocationLine(l, line);
+      if (line > std::numeric_limits<uint16_t>::max())
+        reportingContext.fatal(l, "The file has too many lines for the debug info to be able to map correctly!");
+      debInfo->instructionLineMap.emplace_back((uint16_t)line);
+    }
   }
 
   stringMapCache.release(tempVarMap);
@@ -95,6 +119,284 @@ PexLocalVariable* PexFunctionBuilder::internalAllocateTempVar(const PexString& t
   return loc;
 }
 
+namespace {
+
+struct TempBlock final
+{
+  uint32_t begin{ 0 };
+  uint32_t end{ 0 };
+};
+
+// Everything coalesceTempVars needs while working on a function.
+// This is kept per-thread and reused, so once it has grown to fit
+// the largest function seen, coalescing doesn't allocate.
+struct TempCoalescingScratch final
+{
+  std::vector<PexLocalVariable*> temps{ };
+  // Maps a string index to the index of the temp with that name,
+  // or -1. Only the entries for the current function's temps are
+  // set, and they are cleared again on reset.
+  std::vector<int32_t> tempIndexByString{ };
+
+  std::vector<PexInstruction*> instructions{ };
+  std::vector<int32_t> defs{ };
+  std::vector<bool> isBlockStart{ };
+  std::vector<TempBlock> blocks{ };
+  std::vector<uint32_t> blockOfInstruction{ };
+
+  // Per block, words bits each.
+  std::vector<uint64_t> uses{ };
+  std::vector<uint64_t> kills{ };
+  std::vector<uint64_t> liveIn{ };
+  std::vector<uint64_t> liveOut{ };
+  std::vector<uint64_t> live{ };
+
+  // Per temp, words bits each.
+  std::vector<uint64_t> interference{ };
+  // Per class, words bits each.
+  std::vector<uint64_t> classMembers{ };
+  std::vector<PexLocalVariable*> classRepresentatives{ };
+  std::vector<PexLocalVariable*> renamed{ };
+  std::vector<PexLocalVariable*> keptLocals{ };
+
+  void reset() {
+    for (auto t : temps)
+      tempIndexByString[t->name.index] = -1;
+
+    temps.clear();
+    instructions.clear();
+    defs.clear();
+    isBlockStart.clear();
+    blocks.clear();
+    blockOfInstruction.clear();
+    uses.clear();
+    kills.clear();
+    liveIn.clear();
+    liveOut.clear();
+    live.clear();
+    interference.clear();
+    classMembers.clear();
+    classRepresentatives.clear();
+    renamed.clear();
+    keptLocals.clear();
+  }
+};
+
+}
+
+static thread_local allocators::CachePool<TempCoalescingScratch> coalescingScratchCache{ };
+
+// The free-list in internalAllocateTempVar only reuses a temp once
+// it's been read, and never reuses long-lived temps, so this does
+// a proper liveness analysis over the finished function, and has
+// temps of the same type whose lifetimes don't overlap share a
+// single local.
+void PexFunctionBuilder::coalesceTempVars() {
+  auto& s = *coalescingScratchCache.acquire();
+  struct ReleaseScratch final
+  {
+    TempCoalescingScratch& s;
+    ~ReleaseScratch() { coalescingScratchCache.release(&s); }
+  } releaseScratch{ s };
+
+  for (auto l : locals) {
+    detail::TempVarDescriptor* desc;
+    if (tempVarMap->tryFind(l->name, desc) && desc->localVar == l) {
+      if (s.tempIndexByString.size() <= l->name.index)
+        s.tempIndexByString.resize(l->name.index + 1, -1);
+      s.tempIndexByString[l->name.index] = (int32_t)s.temps.size();
+      s.temps.push_back(l);
+    }
+  }
+  if (s.temps.size() < 2 || !instructions.size())
+    return;
+
+  const auto tempIndexOf = [&s](const PexValue& v) -> int64_t {
+    if (v.type != PexValueType::Identifier || v.val.s.index >= s.tempIndexByString.size())
+      return -1;
+    return s.tempIndexByString[v.val.s.index];
+  };
+
+  const auto count = (uint32_t)instructions.size();
+  s.instructions.reserve(count);
+  for (auto i : instructions)
+    s.instructions.push_back(i);
+
+  const size_t tempCount = s.temps.size();
+  const size_t words = (tempCount + 63) / 64;
+  const auto setBit = [](uint64_t* bits, size_t i) { bits[i / 64] |= 1ULL << (i % 64); };
+  const auto clearBit = [](uint64_t* bits, size_t i) { bits[i / 64] &= ~(1ULL << (i % 64)); };
+  const auto testBit = [](const uint64_t* bits, size_t i) { return (bits[i / 64] & (1ULL << (i % 64))) != 0; };
+
+  // Split the function into basic blocks, so liveness only
+  // needs to be stored per block rather than per instruction.
+  s.defs.resize(count);
+  s.isBlockStart.assign(count + 1, false);
+  s.isBlockStart[0] = true;
+  for (uint32_t i = 0; i < count; i++) {
+    auto instr = s.instructions[i];
+    auto destIdx = PexInstruction::getDestArgIndexForOpCode(instr->opCode);
+    s.defs[i] = destIdx != -1 ? (int32_t)tempIndexOf(instr->args[destIdx]) : -1;
+    if (instr->isBranch()) {
+      auto target = (int64_t)i + instr->branchTarget();
+      if (target >= 0 && target < (int64_t)count)
+        s.isBlockStart[(size_t)target] = true;
+    }
+    if (instr->isBranch() || instr->opCode == PexOpCode::Return)
+      s.isBlockStart[i + 1] = true;
+  }
+  s.blockOfInstruction.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (s.isBlockStart[i])
+      s.blocks.push_back(TempBlock{ i, i });
+    s.blocks.back().end = i + 1;
+    s.blockOfInstruction[i] = (uint32_t)s.blocks.size() - 1;
+  }
+  const size_t blockCount = s.blocks.size();
+
+  // Walk a block backwards from the temps live after it,
+  // calling func with each instruction and the temps live
+  // after that instruction.
+  const auto walkBlock = [&](size_t b, uint64_t* live, auto&& func) {
+    for (auto i = s.blocks[b].end; i > s.blocks[b].begin; i--) {
+      auto idx = i - 1;
+      func(idx, (const uint64_t*)live);
+      if (s.defs[idx] >= 0)
+        clearBit(live, (size_t)s.defs[idx]);
+      s.instructions[idx]->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+        auto t = tempIndexOf(v);
+        if (t >= 0)
+          setBit(live, (size_t)t);
+      });
+    }
+  };
+
+  s.uses.assign(blockCount * words, 0);
+  s.kills.assign(blockCount * words, 0);
+  for (size_t b = 0; b < blockCount; b++) {
+    walkBlock(b, &s.uses[b * words], [&](uint32_t idx, const uint64_t*) {
+      if (s.defs[idx] >= 0)
+        setBit(&s.kills[b * words], (size_t)s.defs[idx]);
+    });
+  }
+
+  s.liveIn.assign(blockCount * words, 0);
+  s.liveOut.assign(blockCount * words, 0);
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t b = blockCount; b > 0; b--) {
+      auto idx = b - 1;
+      auto out = &s.liveOut[idx * words];
+      const auto addSuccessor = [&](size_t succ) {
+        for (size_t w = 0; w < words; w++)
+          out[w] |= s.liveIn[succ * words + w];
+      };
+      auto last = s.instructions[s.blocks[idx].end - 1];
+      if (last->isBranch()) {
+        auto target = (int64_t)(s.blocks[idx].end - 1) + last->branchTarget();
+        if (target >= 0 && target < (int64_t)count)
+          addSuccessor(s.blockOfInstruction[(size_t)target]);
+      }
+      if (last->opCode != PexOpCode::Jmp && last->opCode != PexOpCode::Return && idx + 1 < blockCount)
+        addSuccessor(idx + 1);
+
+      auto in = &s.liveIn[idx * words];
+      for (size_t w = 0; w < words; w++) {
+        auto v = s.uses[idx * words + w] | (out[w] & ~s.kills[idx * words + w]);
+        if (v != in[w]) {
+          in[w] = v;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Two temps interfere if one is written while the other is live.
+  // A copy between two temps doesn't make them interfere, as they
+  // hold the same value afterwards.
+  s.interference.assign(tempCount * words, 0);
+  const auto addInterference = [&](size_t a, size_t b) {
+    setBit(&s.interference[a * words], b);
+    setBit(&s.interference[b * words], a);
+  };
+  for (size_t b = 0; b < blockCount; b++) {
+    s.live.assign(s.liveOut.begin() + b * words, s.liveOut.begin() + (b + 1) * words);
+    walkBlock(b, s.live.data(), [&](uint32_t idx, const uint64_t* live) {
+      if (s.defs[idx] < 0)
+        return;
+      auto d = (size_t)s.defs[idx];
+      auto instr = s.instructions[idx];
+      auto copySrc = instr->opCode == PexOpCode::Assign ? tempIndexOf(instr->args[1]) : -1;
+      for (size_t w = 0; w < words; w++) {
+        if (!live[w])
+          continue;
+        for (size_t t = w * 64; t < tempCount && t < (w + 1) * 64; t++) {
+          if (t != d && (int64_t)t != copySrc && testBit(live, t))
+            addInterference(d, t);
+        }
+      }
+    });
+  }
+  for (size_t a = 0; a < tempCount; a++) {
+    for (size_t b = a + 1; b < tempCount; b++) {
+      if (testBit(&s.liveIn[0], a) && testBit(&s.liveIn[0], b))
+        addInterference(a, b);
+    }
+  }
+
+  // Greedily assign each temp to the first existing temp of
+  // the same type it doesn't interfere with.
+  s.renamed.assign(tempCount, nullptr);
+  for (size_t t = 0; t < tempCount; t++) {
+    auto adj = &s.interference[t * words];
+    for (size_t c = 0; c < s.classRepresentatives.size(); c++) {
+      if (s.classRepresentatives[c]->type != s.temps[t]->type)
+        continue;
+      auto members = &s.classMembers[c * words];
+      bool conflicts = false;
+      for (size_t w = 0; w < words && !conflicts; w++)
+        conflicts = (adj[w] & members[w]) != 0;
+      if (!conflicts) {
+        setBit(members, t);
+        s.renamed[t] = s.classRepresentatives[c];
+        break;
+      }
+    }
+    if (!s.renamed[t]) {
+      s.classRepresentatives.push_back(s.temps[t]);
+      s.classMembers.resize(s.classMembers.size() + words, 0);
+      setBit(&s.classMembers[s.classMembers.size() - words], t);
+      s.renamed[t] = s.temps[t];
+    }
+  }
+  if (s.classRepresentatives.size() == tempCount)
+    return;
+
+  for (auto instr : s.instructions) {
+    for (size_t a = 0; a < instr->args.size(); a++) {
+      auto t = tempIndexOf(instr->args[a]);
+      if (t >= 0 && PexInstruction::getArgKindForOpCode(instr->opCode, a) != PexInstructionArgKind::Name)
+        instr->args[a] = PexValue::Identifier(s.renamed[(size_t)t]);
+    }
+    for (auto v : instr->variadicArgs) {
+      auto t = tempIndexOf(*v);
+      if (t >= 0)
+        *v = PexValue(PexValue::Identifier(s.renamed[(size_t)t]));
+    }
+  }
+
+  s.keptLocals.reserve(locals.size());
+  for (auto l : locals) {
+    auto t = tempIndexOf(PexValue::Identifier(l));
+    if (t < 0 || s.renamed[(size_t)t] == l)
+      s.keptLocals.push_back(l);
+  }
+  IntrusiveLinkedList<PexLocalVariable> newLocals{ };
+  for (auto l : s.keptLocals)
+    newLocals.push_back(l);
+  locals = std::move(newLocals);
+}
+
 PexFunctionBuilder& PexFunctionBuilder::fixup(PexInstruction* instr) {
   for (auto& v : instr->args) {
     if (v.type == PexValueType::Invalid)
@@ -8,6 +8,7 @@
 
 #include <common/allocators/ChainedPool.h>
 #include <common/CapricaFileLocation.h>
+#include <common/CapricaProfile.h>
 #include <common/CapricaReportingContext.h>
 #include <common/identifier_ref.h>
 #include <common/IntrusiveLinkedList.h>
@@ -173,6 +174,12 @@ PexFunctionBuilder& operator <<(op::name&& instr) { return fixup(alloc->make<Pex
     return fixup(alloc->make<PexInstruction>(PexOpCode::CallStatic, instr.a1, instr.a2, instr.a3, std::move(instr.variadicArgs)));
   }
 
+  // Append an instruction copied from another function. Any
+  // branch targets must already be labels in this one.
+  PexFunctionBuilder& operator <<(PexInstruction* instr) {
+    return fixup(instr);
+  }
+
   PexFunctionBuilder& operator <<(CapricaFileLocation loc) {
     currentLocation = loc;
     return *this;
@@ -195,7 +202,11 @@ PexFunctionBuilder& operator <<(op::name&& instr) { return fixup(alloc->make<Pex
   }
 
   PexLocalVariable* allocLongLivedTemp(const papyrus::PapyrusType& tp) {
-    auto v = internalAllocateTempVar(tp.buildPex(file));
+    return allocLongLivedTemp(tp.buildPex(file));
+  }
+
+  PexLocalVariable* allocLongLivedTemp(const PexString& typeName) {
+    auto v = internalAllocateTempVar(typeName);
     tempVarMap->findOrCreate(v->name)->isLongLivedTempVar = true;
     return v;
   }
@@ -257,6 +268,7 @@ PexFunctionBuilder& operator <<(op::name&& instr) { return fixup(alloc->make<Pex
 
 
   void freeValueIfTemp(const PexValue& v);
+  // debInfo may be null if the function doesn't need a line map.
   void populateFunction(PexFunction* func, PexDebugFunctionInfo* debInfo);
 
   explicit PexFunctionBuilder(CapricaReportingContext& repCtx, CapricaFileLocation loc, PexFile* fl);
@@ -266,6 +278,9 @@ PexFunctionBuilder& operator <<(op::name&& instr) { return fixup(alloc->make<Pex
 public:
   CapricaReportingContext& reportingContext;
   allocators::ChainedPool* alloc;
+  // The profile's verdict on the function being built. Cold
+  // functions aren't expanded for speed.
+  CapricaProfileHotness hotness{ CapricaProfileHotness::Unknown };
 
 private:
   PexFile* file;
@@ -282,6 +297,7 @@ private:
 
   PexFunctionBuilder& fixup(PexInstruction* instr);
   PexLocalVariable* internalAllocateTempVar(const PexString& typeName);
+  void coalesceTempVars();
 };
 
 }}
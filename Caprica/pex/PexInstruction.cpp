@@ -58,6 +58,84 @@ int32_t PexInstruction::getDestArgIndexForOpCode(PexOpCode op) {
   CapricaReportingContext::logicalFatal("Unknown PexOpCode!");
 }
 
+template<typename T>
+struct PexInstructionArgKindOf;
+template<>
+struct PexInstructionArgKindOf<PexValue> { static constexpr PexInstructionArgKind value = PexInstructionArgKind::Value; };
+template<>
+struct PexInstructionArgKindOf<PexValue::Identifier> { static constexpr PexInstructionArgKind value = PexInstructionArgKind::Identifier; };
+template<>
+struct PexInstructionArgKindOf<PexString> { static constexpr PexInstructionArgKind value = PexInstructionArgKind::Name; };
+template<>
+struct PexInstructionArgKindOf<PexLabel*> { static constexpr PexInstructionArgKind value = PexInstructionArgKind::Target; };
+
+PexInstructionArgKind PexInstruction::getArgKindForOpCode(PexOpCode op, size_t argIdx) {
+  if ((int32_t)argIdx == PexInstruction::getDestArgIndexForOpCode(op))
+    return PexInstructionArgKind::Dest;
+
+  // These are passed as values to the builder, but are
+  // really names that just happen to be identifiers.
+  switch (op) {
+    case PexOpCode::CallMethod:
+      return argIdx == 0 ? PexInstructionArgKind::Name : PexInstructionArgKind::Identifier;
+    case PexOpCode::CallParent:
+    case PexOpCode::CallStatic:
+      return PexInstructionArgKind::Name;
+    case PexOpCode::Is:
+      if (argIdx == 2)
+        return PexInstructionArgKind::Name;
+      break;
+    case PexOpCode::ArrayFindStruct:
+    case PexOpCode::ArrayRFindStruct:
+      if (argIdx == 2)
+        return PexInstructionArgKind::Name;
+      break;
+    default:
+      break;
+  }
+
+  switch (op) {
+#define OP_ARG1(name, opcode, destArgIdx, argType1, argName1) \
+    case PexOpCode::opcode: { \
+      constexpr PexInstructionArgKind kinds[] = { PexInstructionArgKindOf<argType1>::value }; \
+      return kinds[argIdx]; \
+    }
+#define OP_ARG2(name, opcode, destArgIdx, argType1, argName1, argType2, argName2) \
+    case PexOpCode::opcode: { \
+      constexpr PexInstructionArgKind kinds[] = { PexInstructionArgKindOf<argType1>::value, PexInstructionArgKindOf<argType2>::value }; \
+      return kinds[argIdx]; \
+    }
+#define OP_ARG3(name, opcode, destArgIdx, argType1, argName1, argType2, argName2, argType3, argName3) \
+    case PexOpCode::opcode: { \
+      constexpr PexInstructionArgKind kinds[] = { PexInstructionArgKindOf<argType1>::value, PexInstructionArgKindOf<argType2>::value, PexInstructionArgKindOf<argType3>::value }; \
+      return kinds[argIdx]; \
+    }
+#define OP_ARG4(name, opcode, destArgIdx, argType1, argName1, argType2, argName2, argType3, argName3, argType4, argName4) \
+    case PexOpCode::opcode: { \
+      constexpr PexInstructionArgKind kinds[] = { PexInstructionArgKindOf<argType1>::value, PexInstructionArgKindOf<argType2>::value, PexInstructionArgKindOf<argType3>::value, PexInstructionArgKindOf<argType4>::value }; \
+      return kinds[argIdx]; \
+    }
+#define OP_ARG5(name, opcode, destArgIdx, argType1, argName1, argType2, argName2, argType3, argName3, argType4, argName4, argType5, argName5) \
+    case PexOpCode::opcode: { \
+      constexpr PexInstructionArgKind kinds[] = { PexInstructionArgKindOf<argType1>::value, PexInstructionArgKindOf<argType2>::value, PexInstructionArgKindOf<argType3>::value, PexInstructionArgKindOf<argType4>::value, PexInstructionArgKindOf<argType5>::value }; \
+      return kinds[argIdx]; \
+    }
+    OPCODES(OP_ARG1, OP_ARG2, OP_ARG3, OP_ARG4, OP_ARG5)
+#undef OP_ARG1
+#undef OP_ARG2
+#undef OP_ARG3
+#undef OP_ARG4
+#undef OP_ARG5
+    case PexOpCode::Nop:
+    case PexOpCode::CallMethod:
+    case PexOpCode::CallParent:
+    case PexOpCode::CallStatic:
+    case PexOpCode::Invalid:
+      break;
+  }
+  CapricaReportingContext::logicalFatal("Unknown PexOpCode!");
+}
+
 PexInstruction* PexInstruction::read(allocators::ChainedPool* alloc, PexReader& rdr) {
   auto inst = alloc->make<PexInstruction>();
   inst->opCode = (PexOpCode)rdr.read<uint8_t>();
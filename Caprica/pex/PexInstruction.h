@@ -66,6 +66,22 @@ enum class PexOpCode : uint8_t
 
 using PexInstructionArgs = boost::container::static_vector<caprica::pex::PexValue, 5>;
 
+// How an instruction uses one of its arguments.
+enum class PexInstructionArgKind : uint8_t
+{
+  // The argument is written to.
+  Dest,
+  // The argument is read, and may be a literal.
+  Value,
+  // The argument is read, and must be an identifier.
+  Identifier,
+  // The argument is the name of a function, property,
+  // struct member or type, rather than a value.
+  Name,
+  // The argument is a branch target.
+  Target,
+};
+
 struct PexInstruction final
 {
   static constexpr size_t kMaxRawArgs = 5;
@@ -127,6 +143,20 @@ struct PexInstruction final
     }
   }
   static int32_t getDestArgIndexForOpCode(PexOpCode op);
+  static PexInstructionArgKind getArgKindForOpCode(PexOpCode op, size_t argIdx);
+
+  // Call func with every argument that is read as a value,
+  // including the variadic arguments, along with its kind.
+  template<typename F>
+  void forEachReadArg(F&& func) {
+    for (size_t i = 0; i < args.size(); i++) {
+      auto kind = getArgKindForOpCode(opCode, i);
+      if (kind == PexInstructionArgKind::Value || kind == PexInstructionArgKind::Identifier)
+        func(args[i], kind);
+    }
+    for (auto v : variadicArgs)
+      func(*v, PexInstructionArgKind::Value);
+  }
 
   static PexInstruction* read(allocators::ChainedPool* alloc, PexReader& rdr);
   void write(PexWriter& wtr) const;
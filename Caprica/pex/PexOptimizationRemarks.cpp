@@ -0,0 +1,101 @@
+#include <pex/PexOptimizationRemarks.h>
+
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#include <common/CapricaConfig.h>
+#include <common/CapricaReportingContext.h>
+
+namespace caprica { namespace pex {
+
+static std::mutex remarksMutex{ };
+static std::ofstream remarksStream{ };
+
+static void appendString(std::string& out, identifier_ref str) {
+  out.push_back('"');
+  for (auto c : str) {
+    switch (c) {
+      case '"':
+        out.append("\\\"");
+        break;
+      case '\\':
+        out.append("\\\\");
+        break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          constexpr const char* hex = "0123456789abcdef";
+          out.append("\\u00");
+          out.push_back(hex[(c >> 4) & 0xF]);
+          out.push_back(hex[c & 0xF]);
+        } else {
+          out.push_back(c);
+        }
+        break;
+    }
+  }
+  out.push_back('"');
+}
+
+static const char* functionTypeName(PexDebugFunctionType type) {
+  switch (type) {
+    case PexDebugFunctionType::Normal:
+      return "Normal";
+    case PexDebugFunctionType::Getter:
+      return "Getter";
+    case PexDebugFunctionType::Setter:
+      return "Setter";
+  }
+  CapricaReportingContext::logicalFatal("Unknown PexDebugFunctionType!");
+}
+
+bool PexOptimizationRemarks::enabled() {
+  return !conf::Debug::optimizationRemarksFile.empty();
+}
+
+void PexOptimizationRemarks::emit(const Function& func,
+                                  const char* pass,
+                                  size_t instructionsBefore,
+                                  size_t instructionsAfter,
+                                  size_t tempsBefore,
+                                  size_t tempsAfter) {
+  // Build the line before taking the lock so that threads
+  // only contend on the write itself.
+  std::string line{ };
+  line.reserve(256);
+  line.append("{\"object\":");
+  appendString(line, func.objectName);
+  line.append(",\"state\":");
+  appendString(line, func.stateName);
+  line.append(",\"function\":");
+  appendString(line, func.functionName);
+  line.append(",\"functionType\":");
+  appendString(line, functionTypeName(func.functionType));
+  line.append(",\"pass\":");
+  appendString(line, pass);
+  line.append(",\"instructionsBefore\":").append(std::to_string(instructionsBefore));
+  line.append(",\"instructionsAfter\":").append(std::to_string(instructionsAfter));
+  line.append(",\"tempsBefore\":").append(std::to_string(tempsBefore));
+  line.append(",\"tempsAfter\":").append(std::to_string(tempsAfter));
+  line.append(",\"line\":").append(std::to_string(func.line));
+  line.append("}\n");
+
+  std::unique_lock<std::mutex> lock{ remarksMutex };
+  if (!remarksStream.is_open()) {
+    remarksStream.open(conf::Debug::optimizationRemarksFile, std::ofstream::binary | std::ofstream::trunc);
+    if (!remarksStream.is_open())
+      CapricaReportingContext::logicalFatal("Unable to open the optimization remarks file '%s'!", conf::Debug::optimizationRemarksFile.c_str());
+  }
+  remarksStream.write(line.data(), line.size());
+}
+
+size_t PexOptimizationRemarks::countTemps(const PexFile* file, const IntrusiveLinkedList<PexLocalVariable>& locals) {
+  size_t count = 0;
+  for (auto l : locals) {
+    if (file->getStringValue(l->name).starts_with("::temp"))
+      count++;
+  }
+  return count;
+}
+
+}}
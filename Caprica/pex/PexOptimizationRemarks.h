@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+#include <common/identifier_ref.h>
+#include <common/IntrusiveLinkedList.h>
+
+#include <pex/PexDebugFunctionInfo.h>
+#include <pex/PexFile.h>
+#include <pex/PexLocalVariable.h>
+
+namespace caprica { namespace pex {
+
+// Writes a line of JSON to conf::Debug::optimizationRemarksFile
+// for each pass that changes a function, so the effect of the
+// optimizer can be aggregated across an entire build.
+struct PexOptimizationRemarks final
+{
+  // Identifies the function the same way tryFindFunctionDebugInfo does.
+  struct Function final
+  {
+    identifier_ref objectName{ "" };
+    identifier_ref stateName{ "" };
+    // The name of the property for getters and setters.
+    identifier_ref functionName{ "" };
+    PexDebugFunctionType functionType{ PexDebugFunctionType::Normal };
+    // The source line of the first instruction, or 0 if unknown.
+    size_t line{ 0 };
+  };
+
+  static bool enabled();
+  static void emit(const Function& func,
+                   const char* pass,
+                   size_t instructionsBefore,
+                   size_t instructionsAfter,
+                   size_t tempsBefore,
+                   size_t tempsAfter);
+  // The number of locals that were allocated as temps by codegen.
+  static size_t countTemps(const PexFile* file, const IntrusiveLinkedList<PexLocalVariable>& locals);
+};
+
+}}
@@ -1,175 +1,1101 @@
 #include <pex/PexOptimizer.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <limits>
 #include <vector>
 
-namespace caprica { namespace pex { 
+#include <common/CapricaConfig.h>
+#include <common/CaselessStringComparer.h>
+#include <common/allocators/CachePool.h>
 
-struct OptInstruction final
+#include <pex/PexOptimizationRemarks.h>
+
+namespace caprica { namespace pex {
+
+namespace {
+
+// Instructions whose result depends only on their
+// arguments, and so can be reused if the arguments
+// haven't changed.
+static bool isPureOpCode(PexOpCode op) {
+  switch (op) {
+    case PexOpCode::IAdd:
+    case PexOpCode::FAdd:
+    case PexOpCode::ISub:
+    case PexOpCode::FSub:
+    case PexOpCode::IMul:
+    case PexOpCode::FMul:
+    case PexOpCode::IDiv:
+    case PexOpCode::FDiv:
+    case PexOpCode::IMod:
+    case PexOpCode::Not:
+    case PexOpCode::INeg:
+    case PexOpCode::FNeg:
+    case PexOpCode::Cast:
+    case PexOpCode::CmpEq:
+    case PexOpCode::CmpLt:
+    case PexOpCode::CmpLte:
+    case PexOpCode::CmpGt:
+    case PexOpCode::CmpGte:
+    case PexOpCode::StrCat:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Instructions that can be removed when their result
+// is never read. Division is excluded because dividing
+// by zero is reported by the VM.
+static bool isRemovableWhenUnused(PexOpCode op) {
+  switch (op) {
+    case PexOpCode::IAdd:
+    case PexOpCode::FAdd:
+    case PexOpCode::ISub:
+    case PexOpCode::FSub:
+    case PexOpCode::IMul:
+    case PexOpCode::FMul:
+    case PexOpCode::Not:
+    case PexOpCode::INeg:
+    case PexOpCode::FNeg:
+    case PexOpCode::Assign:
+    case PexOpCode::Cast:
+    case PexOpCode::CmpEq:
+    case PexOpCode::CmpLt:
+    case PexOpCode::CmpLte:
+    case PexOpCode::CmpGt:
+    case PexOpCode::CmpGte:
+    case PexOpCode::StrCat:
+    case PexOpCode::Is:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool isLiteral(const PexValue& v) {
+  switch (v.type) {
+    case PexValueType::String:
+    case PexValueType::Integer:
+    case PexValueType::Float:
+    case PexValueType::Bool:
+      return true;
+    default:
+      return false;
+  }
+}
+
+enum class LocalKind : uint8_t
+{
+  Int,
+  Float,
+  Bool,
+  String,
+  Other,
+};
+
+struct LocalInfo final
+{
+  PexString name{ };
+  PexString type{ };
+  LocalKind kind{ LocalKind::Other };
+};
+
+struct BasicBlock final
+{
+  uint32_t begin{ 0 };
+  uint32_t end{ 0 };
+  uint32_t successors[2]{ };
+  uint8_t successorCount{ 0 };
+};
+
+struct AvailableExpression final
 {
-  size_t id{ 0 };
-  size_t instructionNum{ 0 };
-  PexInstruction* instr{ nullptr };
-  std::vector<OptInstruction*> instructionsReferencingLabel{ };
-  OptInstruction* branchTarget{ nullptr };
-  uint16_t lineNumber{ 0 };
+  PexOpCode opCode{ PexOpCode::Nop };
+  PexValue arg1{ };
+  PexValue arg2{ };
+  PexString destType{ };
+  uint32_t result{ 0 };
+};
+
+// Everything the optimizer needs while working on a function.
+// The instructions are stored as parallel arrays, and branch
+// targets are absolute instruction indices, where a target that
+// has been removed means the next live instruction after it.
+// This is kept per-thread and reused, so once it has grown to
+// fit the largest function seen, optimizing doesn't allocate.
+struct OptimizerScratch final
+{
+  std::vector<PexInstruction*> instructions{ };
+  std::vector<uint32_t> branchTargets{ };
+  std::vector<uint32_t> targetRefCounts{ };
+  std::vector<uint16_t> lines{ };
+  std::vector<uint32_t> newIndices{ };
+
+  std::vector<LocalInfo> locals{ };
+  // Maps a string index to the index of the local with that name,
+  // or -1. Only the entries for the current function's locals are
+  // set, and they are cleared again on reset.
+  std::vector<int32_t> localIndexByString{ };
+
+  std::vector<BasicBlock> blocks{ };
+  std::vector<uint32_t> blockOfInstruction{ };
+  std::vector<uint32_t> worklist{ };
+  std::vector<bool> reachable{ };
+  // The predecessors of block b are predecessors[predecessorOffsets[b]]
+  // up to predecessors[predecessorOffsets[b + 1]].
+  std::vector<uint32_t> predecessorOffsets{ };
+  std::vector<uint32_t> predecessors{ };
+  std::vector<bool> inLoop{ };
+  std::vector<uint32_t> loopBlocks{ };
+
+  std::vector<PexValue> copies{ };
+  std::vector<bool> hasCopy{ };
+  std::vector<uint32_t> activeCopies{ };
+  std::vector<AvailableExpression> expressions{ };
+
+  std::vector<uint64_t> liveIn{ };
+  std::vector<uint64_t> liveOut{ };
+  std::vector<uint64_t> uses{ };
+  std::vector<uint64_t> defs{ };
+  std::vector<uint64_t> live{ };
 
-  explicit OptInstruction(size_t id, PexInstruction* instr) : id(id), instr(instr) { }
-  ~OptInstruction() = default;
+  std::vector<bool> referencedLocals{ };
+  std::vector<PexLocalVariable*> keptLocals{ };
 
-  bool isDead() const {
-    return instr == nullptr || instr->opCode == PexOpCode::Nop;
+  void reset() {
+    for (auto& l : locals)
+      localIndexByString[l.name.index] = -1;
+
+    instructions.clear();
+    branchTargets.clear();
+    targetRefCounts.clear();
+    lines.clear();
+    newIndices.clear();
+    locals.clear();
+    blocks.clear();
+    blockOfInstruction.clear();
+    worklist.clear();
+    reachable.clear();
+    predecessorOffsets.clear();
+    predecessors.clear();
+    inLoop.clear();
+    loopBlocks.clear();
+    copies.clear();
+    hasCopy.clear();
+    activeCopies.clear();
+    expressions.clear();
+    liveIn.clear();
+    liveOut.clear();
+    uses.clear();
+    defs.clear();
+    live.clear();
+    referencedLocals.clear();
+    keptLocals.clear();
   }
+};
+
+static thread_local allocators::CachePool<OptimizerScratch> scratchCache{ };
+
+static constexpr uint32_t NoTarget = std::numeric_limits<uint32_t>::max();
+
+static void setBit(uint64_t* bits, size_t i) {
+  bits[i / 64] |= 1ULL << (i % 64);
+}
+
+static void clearBit(uint64_t* bits, size_t i) {
+  bits[i / 64] &= ~(1ULL << (i % 64));
+}
+
+static bool testBit(const uint64_t* bits, size_t i) {
+  return (bits[i / 64] & (1ULL << (i % 64))) != 0;
+}
+
+struct FunctionOptimizer final
+{
+  FunctionOptimizer(PexFile* file,
+                    PexObject* object,
+                    PexFunction* function,
+                    PexDebugFunctionInfo* debInfo,
+                    const PexOptimizationRemarks::Function* remarks)
+    : file(file), object(object), function(function), debInfo(debInfo), remarks(remarks), s(*scratchCache.acquire()) {
+    auto count = function->instructions.size();
+    s.instructions.reserve(count);
+    s.branchTargets.reserve(count);
+    s.targetRefCounts.assign(count + 1, 0);
+    for (auto cur = function->instructions.begin(), end = function->instructions.end(); cur != end; ++cur) {
+      s.instructions.push_back(*cur);
+      auto target = NoTarget;
+      if (cur->isBranch()) {
+        target = (uint32_t)((int64_t)cur.index + cur->branchTarget());
+        s.targetRefCounts[target]++;
+      }
+      s.branchTargets.push_back(target);
+    }
+    hasLineInfo = debInfo && debInfo->instructionLineMap.size() == count;
+    if (hasLineInfo)
+      s.lines.assign(debInfo->instructionLineMap.begin(), debInfo->instructionLineMap.end());
 
-  void killInstruction() {
-#if 0
-    instr->opCode = PexOpCode::Nop;
-    instr->args.clear();
-    instr->variadicArgs.clear();
-#else
-    delete instr;
-    instr = nullptr;
-    branchTarget = nullptr;
-    lineNumber = 0;
-#endif
+    for (auto p : function->parameters)
+      addLocal(p->name, p->type);
+    for (auto l : function->locals)
+      addLocal(l->name, l->type);
+    words = (s.locals.size() + 63) / 64;
+  }
+
+  ~FunctionOptimizer() {
+    scratchCache.release(&s);
+  }
+
+  void optimize(size_t level) {
+    // Each pass can expose more work for the others, but
+    // in practice this settles within a couple of rounds.
+    for (size_t round = 0; round < 8; round++) {
+      bool changed = runPass("thread-branches", &FunctionOptimizer::threadBranches);
+      changed |= runPass("remove-unreachable-blocks", &FunctionOptimizer::removeUnreachableBlocks);
+      if (level >= 2) {
+        changed |= runPass("propagate-copies-and-cse", &FunctionOptimizer::propagateCopiesAndCommonSubexpressions);
+        changed |= runPass("remove-dead-stores", &FunctionOptimizer::removeDeadStores);
+        if (conf::CodeGeneration::enableLoopInvariantHoisting)
+          changed |= runPass("hoist-loop-invariants", &FunctionOptimizer::hoistLoopInvariants);
+      }
+      if (!changed)
+        break;
+    }
+    if (level >= 2)
+      runPass("remove-unused-locals", &FunctionOptimizer::removeUnusedLocals);
+  }
+
+  // Write the optimized instructions back into the function.
+  void lower() {
+    auto count = s.instructions.size();
+    s.newIndices.resize(count + 1);
+    uint32_t cur = 0;
+    for (size_t i = 0; i < count; i++) {
+      s.newIndices[i] = cur;
+      if (s.instructions[i])
+        cur++;
+    }
+    s.newIndices[count] = cur;
+
+    IntrusiveLinkedList<PexInstruction> newInstructions{ };
+    size_t newLine = 0;
+    for (size_t i = 0; i < count; i++) {
+      auto instr = s.instructions[i];
+      if (!instr)
+        continue;
+      if (instr->isBranch())
+        instr->setBranchTarget((int)s.newIndices[s.branchTargets[i]] - (int)s.newIndices[i]);
+      newInstructions.push_back(instr);
+      // Compacted in place, as the new index is never
+      // greater than the old one.
+      if (hasLineInfo)
+        s.lines[newLine++] = s.lines[i];
+    }
+
+    function->instructions = std::move(newInstructions);
+    if (hasLineInfo)
+      debInfo->instructionLineMap.assign(s.lines.begin(), s.lines.begin() + newLine);
   }
 
 private:
-  explicit OptInstruction() = default;
-};
+  PexFile* file;
+  PexObject* object;
+  PexFunction* function;
+  PexDebugFunctionInfo* debInfo;
+  const PexOptimizationRemarks::Function* remarks;
+  OptimizerScratch& s;
+  bool hasLineInfo{ false };
+  size_t words{ 0 };
 
-static std::vector<OptInstruction*> buildOptInstructions(const PexDebugFunctionInfo* debInfo,
-                                                         IntrusiveLinkedList<PexInstruction>& instructions) {
-  std::unordered_map<size_t, OptInstruction*> labelMap;
-  for (auto cur = instructions.begin(), end = instructions.end(); cur != end; ++cur) {
-    if (cur->isBranch()) {
-      auto targI = cur->branchTarget() + cur.index;
-      if (!labelMap.count((size_t)(targI)))
-        labelMap.emplace((size_t)targI, new OptInstruction(0, nullptr));
+  size_t liveInstructionCount() const {
+    size_t count = 0;
+    for (auto instr : s.instructions) {
+      if (instr)
+        count++;
     }
+    return count;
   }
 
-  std::vector<OptInstruction*> optimizedInstructions{ };
-  optimizedInstructions.reserve(instructions.size());
-  size_t id = 0;
-  for (auto cur = instructions.begin(), end = instructions.end(); cur != end; ++cur, id++) {
-    auto f = labelMap.find(cur.index);
-    if (f != labelMap.end()) {
-      f->second->id = id++;
-      optimizedInstructions.emplace_back(f->second);
+  // Run the pass, and emit a remark if it changed anything.
+  bool runPass(const char* name, bool (FunctionOptimizer::*pass)()) {
+    if (!remarks)
+      return (this->*pass)();
+
+    auto instructionsBefore = liveInstructionCount();
+    auto tempsBefore = PexOptimizationRemarks::countTemps(file, function->locals);
+    bool changed = (this->*pass)();
+    if (changed) {
+      PexOptimizationRemarks::emit(*remarks, name,
+                                   instructionsBefore, liveInstructionCount(),
+                                   tempsBefore, PexOptimizationRemarks::countTemps(file, function->locals));
     }
+    return changed;
+  }
+
+  void addLocal(PexString name, PexString type) {
+    LocalInfo info{ };
+    info.name = name;
+    info.type = type;
+    auto typeName = file->getStringValue(type);
+    if (idEq(typeName, "int"))
+      info.kind = LocalKind::Int;
+    else if (idEq(typeName, "float"))
+      info.kind = LocalKind::Float;
+    else if (idEq(typeName, "bool"))
+      info.kind = LocalKind::Bool;
+    else if (idEq(typeName, "string"))
+      info.kind = LocalKind::String;
+
+    if (s.localIndexByString.size() <= name.index)
+      s.localIndexByString.resize(name.index + 1, -1);
+    s.localIndexByString[name.index] = (int32_t)s.locals.size();
+    s.locals.push_back(info);
+  }
+
+  // The index of the local or parameter referenced by the
+  // value, or -1 if it isn't one. Object variables are
+  // never tracked, as calls can change them.
+  int64_t localIndexOf(const PexValue& v) const {
+    if (v.type != PexValueType::Identifier || v.val.s.index >= s.localIndexByString.size())
+      return -1;
+    return s.localIndexByString[v.val.s.index];
+  }
 
-    auto o = new OptInstruction(id, *cur);
-    if (debInfo && cur.index < debInfo->instructionLineMap.size())
-      o->lineNumber = debInfo->instructionLineMap[cur.index];
-    if (o->instr->isBranch()) {
-      o->branchTarget = labelMap[(size_t)(o->instr->branchTarget() + cur.index)];
-      o->branchTarget->instructionsReferencingLabel.push_back(o);
+  bool isPrimitiveLocal(int64_t idx) const {
+    return idx >= 0 && s.locals[(size_t)idx].kind != LocalKind::Other;
+  }
+
+  static bool literalMatchesKind(const PexValue& v, LocalKind kind) {
+    switch (v.type) {
+      case PexValueType::Integer:
+        return kind == LocalKind::Int;
+      case PexValueType::Float:
+        return kind == LocalKind::Float;
+      case PexValueType::Bool:
+        return kind == LocalKind::Bool;
+      case PexValueType::String:
+        return kind == LocalKind::String;
+      default:
+        return false;
     }
-    optimizedInstructions.emplace_back(o);
   }
 
-  auto f = labelMap.find(instructions.size());
-  if (f != labelMap.end()) {
-    f->second->id = optimizedInstructions.size();
-    optimizedInstructions.emplace_back(f->second);
+  // A value whose meaning can't change without the local
+  // holding it being written to. Objects, arrays and structs
+  // are excluded because comparing or converting them can
+  // depend on their contents.
+  bool isStableValue(const PexValue& v) const {
+    return isLiteral(v) || isPrimitiveLocal(localIndexOf(v));
   }
-  return optimizedInstructions;
-}
 
-void PexOptimizer::optimize(PexFile* file,
-                            PexObject* object,
-                            PexState* state,
-                            PexFunction* function,
-                            const std::string& propertyName,
-                            PexDebugFunctionType functionType) {
-  PexDebugFunctionInfo* debInfo = file->tryFindFunctionDebugInfo(object, state, function, propertyName, functionType);
-  auto optimizedInstructions = buildOptInstructions(debInfo, function->instructions);
+  int64_t destLocalOf(const PexInstruction* instr) const {
+    auto destIdx = PexInstruction::getDestArgIndexForOpCode(instr->opCode);
+    if (destIdx == -1 || (size_t)destIdx >= instr->args.size())
+      return -1;
+    return localIndexOf(instr->args[destIdx]);
+  }
+
+  uint32_t firstLiveFrom(uint32_t idx) const {
+    for (auto i = idx; i < s.instructions.size(); i++) {
+      if (s.instructions[i])
+        return i;
+    }
+    return (uint32_t)s.instructions.size();
+  }
+
+  void retarget(uint32_t idx, uint32_t target) {
+    s.targetRefCounts[s.branchTargets[idx]]--;
+    s.branchTargets[idx] = target;
+    s.targetRefCounts[target]++;
+  }
+
+  void kill(uint32_t idx) {
+    if (s.branchTargets[idx] != NoTarget) {
+      s.targetRefCounts[s.branchTargets[idx]]--;
+      s.branchTargets[idx] = NoTarget;
+    }
+    // The instruction itself is owned by the file's allocator,
+    // so we only drop our reference to it.
+    s.instructions[idx] = nullptr;
+  }
+
+  void buildBlocks() {
+    auto count = (uint32_t)s.instructions.size();
+    s.blocks.clear();
+    s.blockOfInstruction.resize(count + 1);
+
+    uint32_t start = 0;
+    const auto closeBlock = [this, &start](uint32_t end) {
+      BasicBlock b{ };
+      b.begin = start;
+      b.end = end;
+      for (auto i = start; i < end; i++)
+        s.blockOfInstruction[i] = (uint32_t)s.blocks.size();
+      s.blocks.push_back(b);
+      start = end;
+    };
+
+    for (uint32_t i = 0; i < count; i++) {
+      if (s.targetRefCounts[i] && i != start)
+        closeBlock(i);
+      auto instr = s.instructions[i];
+      if (instr && (instr->isBranch() || instr->opCode == PexOpCode::Return))
+        closeBlock(i + 1);
+    }
+    if (start < count || s.blocks.size() == 0)
+      closeBlock(count);
+    // Branching to the end of the function lands in a block
+    // of its own with nothing in it.
+    s.blockOfInstruction[count] = (uint32_t)s.blocks.size();
+
+    for (size_t b = 0; b < s.blocks.size(); b++) {
+      auto& block = s.blocks[b];
+      PexInstruction* last = nullptr;
+      uint32_t lastIdx = 0;
+      for (auto i = block.end; i > block.begin; i--) {
+        if (s.instructions[i - 1]) {
+          last = s.instructions[i - 1];
+          lastIdx = i - 1;
+          break;
+        }
+      }
+
+      bool fallsThrough = true;
+      if (last) {
+        if (last->opCode == PexOpCode::Return) {
+          fallsThrough = false;
+        } else if (last->isBranch()) {
+          auto targetBlock = s.blockOfInstruction[s.branchTargets[lastIdx]];
+          if (targetBlock < s.blocks.size())
+            block.successors[block.successorCount++] = targetBlock;
+          fallsThrough = last->opCode != PexOpCode::Jmp;
+        }
+      }
+      if (fallsThrough && b + 1 < s.blocks.size())
+        block.successors[block.successorCount++] = (uint32_t)b + 1;
+    }
+  }
+
+  // Retarget branches that land on an unconditional jump,
+  // fold branches on literal conditions, and remove branches
+  // to the instruction that would run next anyways.
+  bool threadBranches() {
+    bool changed = false;
+    auto count = (uint32_t)s.instructions.size();
+    for (uint32_t i = 0; i < count; i++) {
+      auto instr = s.instructions[i];
+      if (!instr || !instr->isBranch())
+        continue;
+
+      auto target = s.branchTargets[i];
+      auto dest = firstLiveFrom(target);
+      for (size_t hops = 0; dest < count && dest != i && s.instructions[dest]->opCode == PexOpCode::Jmp && hops < count; hops++) {
+        target = s.branchTargets[dest];
+        dest = firstLiveFrom(target);
+      }
+      if (target != s.branchTargets[i]) {
+        retarget(i, target);
+        changed = true;
+      }
+
+      if (instr->opCode != PexOpCode::Jmp) {
+        auto& cond = instr->args[0];
+        bool known = true;
+        bool truthy = false;
+        if (cond.type == PexValueType::Bool)
+          truthy = cond.val.b;
+        else if (cond.type == PexValueType::Integer)
+          truthy = cond.val.i != 0;
+        else if (cond.type == PexValueType::None)
+          truthy = false;
+        else
+          known = false;
+
+        if (known) {
+          if (truthy == (instr->opCode == PexOpCode::JmpT)) {
+            instr->opCode = PexOpCode::Jmp;
+            instr->args.erase(instr->args.begin());
+          } else {
+            kill(i);
+          }
+          changed = true;
+          continue;
+        }
+      }
+
+      if (firstLiveFrom(i + 1) == dest) {
+        kill(i);
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  bool removeUnreachableBlocks() {
+    buildBlocks();
+    s.reachable.assign(s.blocks.size(), false);
+    s.worklist.clear();
+    s.worklist.push_back(0);
+    s.reachable[0] = true;
+    while (s.worklist.size()) {
+      auto b = s.worklist.back();
+      s.worklist.pop_back();
+      auto& block = s.blocks[b];
+      for (size_t j = 0; j < block.successorCount; j++) {
+        auto succ = block.successors[j];
+        if (!s.reachable[succ]) {
+          s.reachable[succ] = true;
+          s.worklist.push_back(succ);
+        }
+      }
+    }
 
-  const auto isDeadBetween = [&optimizedInstructions](size_t startID, size_t endID) -> bool {
-    for (size_t i = startID + 1; i <= endID; i++) {
-      assert(i < optimizedInstructions.size());
-      if (!optimizedInstructions[i]->isDead())
+    bool changed = false;
+    for (size_t b = 0; b < s.blocks.size(); b++) {
+      if (s.reachable[b])
+        continue;
+      for (auto i = s.blocks[b].begin; i < s.blocks[b].end; i++) {
+        if (s.instructions[i]) {
+          kill(i);
+          changed = true;
+        }
+      }
+    }
+    return changed;
+  }
+
+  void clearCopies() {
+    for (auto c : s.activeCopies)
+      s.hasCopy[c] = false;
+    s.activeCopies.clear();
+  }
+
+  // Block local value numbering. Reads of locals that were
+  // copied from another local or a literal are replaced with
+  // the original, and recomputations of a pure expression are
+  // replaced with a copy of the previous result.
+  bool propagateCopiesAndCommonSubexpressions() {
+    buildBlocks();
+    bool changed = false;
+    s.copies.resize(s.locals.size());
+    s.hasCopy.assign(s.locals.size(), false);
+    s.activeCopies.clear();
+
+    for (auto& block : s.blocks) {
+      clearCopies();
+      s.expressions.clear();
+
+      for (auto i = block.begin; i < block.end; i++) {
+        auto instr = s.instructions[i];
+        if (!instr)
+          continue;
+
+        instr->forEachReadArg([&](PexValue& v, PexInstructionArgKind kind) {
+          auto idx = localIndexOf(v);
+          if (idx < 0 || !s.hasCopy[(size_t)idx])
+            return;
+          auto& copy = s.copies[(size_t)idx];
+          if (kind == PexInstructionArgKind::Identifier && copy.type != PexValueType::Identifier)
+            return;
+          v = copy;
+          changed = true;
+        });
+
+        if (instr->opCode == PexOpCode::Assign && instr->args[0] == instr->args[1]) {
+          kill(i);
+          changed = true;
+          continue;
+        }
+
+        auto dest = destLocalOf(instr);
+        if (dest < 0)
+          continue;
+
+        bool isExpression = isPureOpCode(instr->opCode) && isPrimitiveLocal(dest);
+        for (size_t a = 1; isExpression && a < instr->args.size(); a++) {
+          if (!isStableValue(instr->args[a]))
+            isExpression = false;
+        }
+
+        AvailableExpression expr{ };
+        if (isExpression) {
+          expr.opCode = instr->opCode;
+          expr.arg1 = instr->args[1];
+          if (instr->args.size() > 2)
+            expr.arg2 = instr->args[2];
+          expr.destType = s.locals[(size_t)dest].type;
+          expr.result = (uint32_t)dest;
+
+          for (auto& e : s.expressions) {
+            if (e.opCode == expr.opCode && e.arg1 == expr.arg1 && e.arg2 == expr.arg2 && e.destType == expr.destType) {
+              if (e.result == (uint32_t)dest) {
+                kill(i);
+              } else {
+                instr->opCode = PexOpCode::Assign;
+                instr->args.resize(2);
+                instr->args[1] = PexValue::Identifier(s.locals[e.result].name);
+              }
+              changed = true;
+              isExpression = false;
+              break;
+            }
+          }
+          if (!s.instructions[i])
+            continue;
+        }
+
+        // The destination now holds a new value, so anything
+        // based on the old one is stale.
+        for (size_t c = s.activeCopies.size(); c > 0; c--) {
+          auto key = s.activeCopies[c - 1];
+          if (key == (uint32_t)dest || localIndexOf(s.copies[key]) == dest) {
+            s.hasCopy[key] = false;
+            s.activeCopies[c - 1] = s.activeCopies.back();
+            s.activeCopies.pop_back();
+          }
+        }
+        for (size_t e = s.expressions.size(); e > 0; e--) {
+          auto& ex = s.expressions[e - 1];
+          if (ex.result == (uint32_t)dest || localIndexOf(ex.arg1) == dest || localIndexOf(ex.arg2) == dest) {
+            ex = s.expressions.back();
+            s.expressions.pop_back();
+          }
+        }
+
+        if (instr->opCode == PexOpCode::Assign) {
+          auto& src = instr->args[1];
+          auto srcIdx = localIndexOf(src);
+          auto& destInfo = s.locals[(size_t)dest];
+          if (srcIdx >= 0 ? s.locals[(size_t)srcIdx].type == destInfo.type : literalMatchesKind(src, destInfo.kind)) {
+            s.copies[(size_t)dest] = src;
+            s.hasCopy[(size_t)dest] = true;
+            s.activeCopies.push_back((uint32_t)dest);
+          }
+        } else if (isExpression && localIndexOf(expr.arg1) != dest && localIndexOf(expr.arg2) != dest) {
+          s.expressions.push_back(expr);
+        }
+      }
+    }
+    return changed;
+  }
+
+  // Remove writes to locals that are never read afterwards,
+  // and fold a Not into the conditional branch that consumes it.
+  bool removeDeadStores() {
+    buildBlocks();
+    auto blockCount = s.blocks.size();
+    s.liveIn.assign(blockCount * words, 0);
+    s.liveOut.assign(blockCount * words, 0);
+    s.uses.assign(blockCount * words, 0);
+    s.defs.assign(blockCount * words, 0);
+
+    for (size_t b = 0; b < blockCount; b++) {
+      auto uses = &s.uses[b * words];
+      auto defs = &s.defs[b * words];
+      for (auto i = s.blocks[b].begin; i < s.blocks[b].end; i++) {
+        auto instr = s.instructions[i];
+        if (!instr)
+          continue;
+        instr->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+          auto idx = localIndexOf(v);
+          if (idx >= 0 && !testBit(defs, (size_t)idx))
+            setBit(uses, (size_t)idx);
+        });
+        auto dest = destLocalOf(instr);
+        if (dest >= 0)
+          setBit(defs, (size_t)dest);
+      }
+    }
+
+    for (bool dirty = true; dirty;) {
+      dirty = false;
+      for (size_t b = blockCount; b > 0; b--) {
+        auto& block = s.blocks[b - 1];
+        auto out = &s.liveOut[(b - 1) * words];
+        for (size_t j = 0; j < block.successorCount; j++) {
+          auto succIn = &s.liveIn[block.successors[j] * words];
+          for (size_t w = 0; w < words; w++)
+            out[w] |= succIn[w];
+        }
+        auto in = &s.liveIn[(b - 1) * words];
+        auto uses = &s.uses[(b - 1) * words];
+        auto defs = &s.defs[(b - 1) * words];
+        for (size_t w = 0; w < words; w++) {
+          auto v = uses[w] | (out[w] & ~defs[w]);
+          if (v != in[w]) {
+            in[w] = v;
+            dirty = true;
+          }
+        }
+      }
+    }
+
+    bool changed = false;
+    s.live.resize(words);
+    auto live = s.live.data();
+    for (size_t b = 0; b < blockCount; b++) {
+      auto out = &s.liveOut[b * words];
+      std::copy(out, out + words, live);
+      uint32_t branch = NoTarget;
+      for (auto i = s.blocks[b].end; i > s.blocks[b].begin; i--) {
+        auto idx = i - 1;
+        auto instr = s.instructions[idx];
+        if (!instr)
+          continue;
+
+        auto dest = destLocalOf(instr);
+        if (dest >= 0 && !testBit(live, (size_t)dest) && isRemovableWhenUnused(instr->opCode)) {
+          kill(idx);
+          changed = true;
+          continue;
+        }
+
+        // not t, x; jmpf t, L -> jmpt x, L when t is dead afterwards.
+        if (branch != NoTarget && instr->opCode == PexOpCode::Not && dest >= 0) {
+          auto branchInstr = s.instructions[branch];
+          if (branchInstr->args[0] == instr->args[0] && !testBit(out, (size_t)dest) && localIndexOf(instr->args[1]) != dest) {
+            branchInstr->opCode = branchInstr->opCode == PexOpCode::JmpF ? PexOpCode::JmpT : PexOpCode::JmpF;
+            branchInstr->args[0] = instr->args[1];
+            kill(idx);
+            changed = true;
+            clearBit(live, (size_t)dest);
+            auto src = localIndexOf(branchInstr->args[0]);
+            if (src >= 0)
+              setBit(live, (size_t)src);
+            branch = NoTarget;
+            continue;
+          }
+        }
+        branch = (instr->opCode == PexOpCode::JmpT || instr->opCode == PexOpCode::JmpF) && i == s.blocks[b].end ? idx : NoTarget;
+
+        if (dest >= 0)
+          clearBit(live, (size_t)dest);
+        instr->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+          auto idx = localIndexOf(v);
+          if (idx >= 0)
+            setBit(live, (size_t)idx);
+        });
+      }
+    }
+    return changed;
+  }
+
+  // Move instructions whose result can't change while a loop is
+  // running out of the loop's header, so they run once when the
+  // loop is entered rather than on every iteration. This only
+  // considers loops without calls or property accesses that could
+  // run other code, and only the header, as everything there runs
+  // at least once whenever the loop is entered.
+  bool hoistLoopInvariants() {
+    bool changed = false;
+    // Each hoist reshapes the blocks around the loop, so
+    // start again from scratch after every one.
+    for (size_t hoisted = 0; hoisted < s.instructions.size(); hoisted++) {
+      buildBlocks();
+      buildPredecessors();
+      if (!hoistOneLoopInvariant())
+        break;
+      changed = true;
+    }
+    return changed;
+  }
+
+  void buildPredecessors() {
+    auto blockCount = s.blocks.size();
+    s.predecessorOffsets.assign(blockCount + 1, 0);
+    for (auto& block : s.blocks) {
+      for (size_t j = 0; j < block.successorCount; j++)
+        s.predecessorOffsets[block.successors[j] + 1]++;
+    }
+    for (size_t b = 0; b < blockCount; b++)
+      s.predecessorOffsets[b + 1] += s.predecessorOffsets[b];
+
+    s.predecessors.resize(s.predecessorOffsets[blockCount]);
+    s.worklist.assign(s.predecessorOffsets.begin(), s.predecessorOffsets.end() - 1);
+    for (size_t b = 0; b < blockCount; b++) {
+      auto& block = s.blocks[b];
+      for (size_t j = 0; j < block.successorCount; j++)
+        s.predecessors[s.worklist[block.successors[j]]++] = (uint32_t)b;
+    }
+  }
+
+  uint32_t lastLiveInBlock(uint32_t b) const {
+    for (auto i = s.blocks[b].end; i > s.blocks[b].begin; i--) {
+      if (s.instructions[i - 1])
+        return i - 1;
+    }
+    return NoTarget;
+  }
+
+  // Find the blocks of the loop headed by the given block, if it
+  // heads one. The loop must only be entered through its header,
+  // and every edge back to the header must be a branch, so that
+  // it can be pointed past a hoisted instruction.
+  bool collectLoop(uint32_t header) {
+    auto blockCount = s.blocks.size();
+    s.inLoop.assign(blockCount, false);
+    s.loopBlocks.clear();
+    s.worklist.clear();
+    s.inLoop[header] = true;
+    s.loopBlocks.push_back(header);
+    bool hasBackEdge = false;
+    for (auto p = s.predecessorOffsets[header]; p < s.predecessorOffsets[header + 1]; p++) {
+      auto pred = s.predecessors[p];
+      if (pred < header)
+        continue;
+      hasBackEdge = true;
+      if (!s.inLoop[pred]) {
+        s.inLoop[pred] = true;
+        s.loopBlocks.push_back(pred);
+        s.worklist.push_back(pred);
+      }
+    }
+    if (!hasBackEdge)
+      return false;
+
+    while (s.worklist.size()) {
+      auto b = s.worklist.back();
+      s.worklist.pop_back();
+      if (b == 0)
         return false;
+      for (auto p = s.predecessorOffsets[b]; p < s.predecessorOffsets[b + 1]; p++) {
+        auto pred = s.predecessors[p];
+        if (!s.inLoop[pred]) {
+          s.inLoop[pred] = true;
+          s.loopBlocks.push_back(pred);
+          s.worklist.push_back(pred);
+        }
+      }
+    }
+
+    for (auto b : s.loopBlocks) {
+      if (b == header) {
+        for (auto p = s.predecessorOffsets[b]; p < s.predecessorOffsets[b + 1]; p++) {
+          auto pred = s.predecessors[p];
+          if (!s.inLoop[pred])
+            continue;
+          auto last = lastLiveInBlock(pred);
+          if (last == NoTarget || !s.instructions[last]->isBranch() || s.blockOfInstruction[s.branchTargets[last]] != header)
+            return false;
+          if (pred + 1 == header && s.instructions[last]->opCode != PexOpCode::Jmp)
+            return false;
+        }
+        continue;
+      }
+      for (auto p = s.predecessorOffsets[b]; p < s.predecessorOffsets[b + 1]; p++) {
+        if (!s.inLoop[s.predecessors[p]])
+          return false;
+      }
     }
     return true;
-  };
-  const auto nextNonDead = [&optimizedInstructions](size_t startID) -> OptInstruction* {
-    for (size_t i = startID + 1; i < optimizedInstructions.size(); i++) {
-      if (!optimizedInstructions[i]->isDead())
-        return optimizedInstructions[i];
+  }
+
+  bool isSelf(const PexValue& v) const {
+    return v.type == PexValueType::Identifier && idEq(file->getStringValue(v.val.s), "self");
+  }
+
+  // The auto property that a PropGet or PropSet on self accesses,
+  // if it is one. Accessing those can't run any other code.
+  const PexProperty* selfAutoPropertyOf(const PexInstruction* instr) const {
+    if (!isSelf(instr->args[1]) || instr->args[0].type != PexValueType::Identifier)
+      return nullptr;
+    for (auto p : object->properties) {
+      if (p->name == instr->args[0].val.s)
+        return p->isAuto ? p : nullptr;
     }
     return nullptr;
-  };
-
-  for (int i = (int)optimizedInstructions.size() - 1; i >= 0; i--) {
-    auto opt = optimizedInstructions[i];
-    if (opt->instr) {
-      switch (opt->instr->opCode) {
-        case PexOpCode::Assign:
-          if (opt->instr->args[0] == opt->instr->args[1])
-            opt->killInstruction();
-          break;
-        case PexOpCode::Jmp:
-          if (opt->id < opt->branchTarget->id && isDeadBetween(opt->id, opt->branchTarget->id))
-            opt->killInstruction();
-          break;
-#if 0
-        case PexOpCode::Not: {
-          if (i <= 1)
-            break;
-
-          auto n = nextNonDead(opt->id);
-          if (!n)
-            break;
-          if (n->instr->opCode != PexOpCode::JmpF && n->instr->opCode != PexOpCode::JmpT)
-            break;
-          // Ensure source of branch is dest of not.
-          if (opt->instr->args[0] != n->instr->args[0])
-            break;
-
-          if (n->instr->opCode == PexOpCode::JmpF)
-            n->instr->opCode = PexOpCode::JmpT;
-          else if (n->instr->opCode == PexOpCode::JmpT)
-            n->instr->opCode = PexOpCode::JmpF;
-          else
-            CapricaReportingContext::logicalFatal("Somehow got a weird op-code here.");
-          n->instr->args[0] = opt->instr->args[1];
-          opt->killInstruction();
-          break;
+  }
+
+  bool isWrittenInLoop(const PexValue& v) const {
+    for (auto b : s.loopBlocks) {
+      for (auto i = s.blocks[b].begin; i < s.blocks[b].end; i++) {
+        auto instr = s.instructions[i];
+        if (!instr)
+          continue;
+        auto destIdx = PexInstruction::getDestArgIndexForOpCode(instr->opCode);
+        if (destIdx != -1 && (size_t)destIdx < instr->args.size() && instr->args[destIdx] == v)
+          return true;
+      }
+    }
+    return false;
+  }
+
+  size_t countWritesInLoop(int64_t local) const {
+    size_t count = 0;
+    for (auto b : s.loopBlocks) {
+      for (auto i = s.blocks[b].begin; i < s.blocks[b].end; i++) {
+        if (s.instructions[i] && destLocalOf(s.instructions[i]) == local)
+          count++;
+      }
+    }
+    return count;
+  }
+
+  bool isInvariantInLoop(const PexInstruction* instr, bool loopResizesArrays) const {
+    switch (instr->opCode) {
+      case PexOpCode::ArrayLength:
+        return !loopResizesArrays && !isWrittenInLoop(instr->args[1]);
+      case PexOpCode::PropGet: {
+        auto prop = selfAutoPropertyOf(instr);
+        if (!prop || isWrittenInLoop(PexValue::Identifier(prop->autoVar)))
+          return false;
+        for (auto b : s.loopBlocks) {
+          for (auto i = s.blocks[b].begin; i < s.blocks[b].end; i++) {
+            auto other = s.instructions[i];
+            if (other && other->opCode == PexOpCode::PropSet && other->args[0] == instr->args[0])
+              return false;
+          }
         }
-#endif
-        default:
-          break;
+        return true;
       }
+      default:
+        return false;
     }
   }
 
-  size_t curInstrNum = 0;
-  for (auto& i : optimizedInstructions) {
-    i->instructionNum = curInstrNum;
-    if (i->instr)
-      curInstrNum++;
+  bool hoistOneLoopInvariant() {
+    auto blockCount = (uint32_t)s.blocks.size();
+    for (uint32_t header = 0; header < blockCount; header++) {
+      if (!collectLoop(header))
+        continue;
+
+      bool loopResizesArrays = false;
+      bool loopRunsOtherCode = false;
+      for (auto b : s.loopBlocks) {
+        for (auto i = s.blocks[b].begin; i < s.blocks[b].end && !loopRunsOtherCode; i++) {
+          auto instr = s.instructions[i];
+          if (!instr)
+            continue;
+          switch (instr->opCode) {
+            case PexOpCode::CallMethod:
+            case PexOpCode::CallParent:
+            case PexOpCode::CallStatic:
+              loopRunsOtherCode = true;
+              break;
+            case PexOpCode::PropGet:
+            case PexOpCode::PropSet:
+              loopRunsOtherCode = !selfAutoPropertyOf(instr);
+              break;
+            case PexOpCode::ArrayAdd:
+            case PexOpCode::ArrayInsert:
+            case PexOpCode::ArrayRemoveLast:
+            case PexOpCode::ArrayRemove:
+            case PexOpCode::ArrayClear:
+              loopResizesArrays = true;
+              break;
+            default:
+              break;
+          }
+        }
+      }
+      if (loopRunsOtherCode)
+        continue;
+
+      auto& block = s.blocks[header];
+      for (auto i = block.begin; i < block.end; i++) {
+        auto instr = s.instructions[i];
+        if (!instr || !isInvariantInLoop(instr, loopResizesArrays))
+          continue;
+        auto dest = destLocalOf(instr);
+        if (dest < 0 || countWritesInLoop(dest) != 1)
+          continue;
+
+        // Anything earlier in the header that reads the old value
+        // would see the new one once this is moved in front of it.
+        bool readEarlier = false;
+        for (auto j = block.begin; j < i && !readEarlier; j++) {
+          if (s.instructions[j]) {
+            s.instructions[j]->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+              if (localIndexOf(v) == dest)
+                readEarlier = true;
+            });
+          }
+        }
+        if (readEarlier)
+          continue;
+
+        // Move the instruction to the start of the header, then point
+        // the edges from inside the loop just past it. Nothing branches
+        // into the middle of a block, so no other targets move.
+        std::rotate(s.instructions.begin() + block.begin, s.instructions.begin() + i, s.instructions.begin() + i + 1);
+        std::rotate(s.branchTargets.begin() + block.begin, s.branchTargets.begin() + i, s.branchTargets.begin() + i + 1);
+        if (hasLineInfo)
+          std::rotate(s.lines.begin() + block.begin, s.lines.begin() + i, s.lines.begin() + i + 1);
+        for (auto b : s.loopBlocks) {
+          auto last = lastLiveInBlock(b);
+          if (last != NoTarget && s.branchTargets[last] == block.begin)
+            retarget(last, block.begin + 1);
+        }
+        return true;
+      }
+    }
+    return false;
   }
 
-  IntrusiveLinkedList<PexInstruction> newInstructions{ };
-  std::vector<uint16_t> newLineInfo{ };
-  newLineInfo.reserve(curInstrNum);
-  for (auto& i : optimizedInstructions) {
-    if (i->instr) {
-      newLineInfo.push_back(i->lineNumber);
-      newInstructions.push_back(i->instr);
-      if (i->instr->isBranch())
-        i->instr->setBranchTarget((int)i->branchTarget->instructionNum - (int)i->instructionNum);
+  bool removeUnusedLocals() {
+    s.referencedLocals.assign(s.locals.size(), false);
+    const auto reference = [this](const PexValue& v) {
+      auto idx = localIndexOf(v);
+      if (idx >= 0)
+        s.referencedLocals[(size_t)idx] = true;
+    };
+    for (auto instr : s.instructions) {
+      if (!instr)
+        continue;
+      for (auto& a : instr->args)
+        reference(a);
+      for (auto v : instr->variadicArgs)
+        reference(*v);
     }
+
+    for (auto l : function->locals) {
+      auto idx = localIndexOf(PexValue::Identifier(l->name));
+      if (idx < 0 || s.referencedLocals[(size_t)idx])
+        s.keptLocals.push_back(l);
+    }
+    if (s.keptLocals.size() == function->locals.size())
+      return false;
+
+    IntrusiveLinkedList<PexLocalVariable> newLocals{ };
+    for (auto l : s.keptLocals)
+      newLocals.push_back(l);
+    function->locals = std::move(newLocals);
+    return true;
   }
+};
 
-  function->instructions = std::move(newInstructions);
-  if (debInfo)
-    debInfo->instructionLineMap = std::move(newLineInfo);
+}
 
-  for (auto& i : optimizedInstructions)
-    delete i;
+void PexOptimizer::optimize(PexFile* file,
+                            PexObject* object,
+                            PexState* state,
+                            PexFunction* function,
+                            const std::string& propertyName,
+                            PexDebugFunctionType functionType) {
+  stats.instructionsBefore += function->instructions.size();
+  if (function->instructions.size() != 0) {
+    PexDebugFunctionInfo* debInfo = file->tryFindFunctionDebugInfo(object, state, function, propertyName, functionType);
+    PexOptimizationRemarks::Function remarkFunction{ };
+    if (PexOptimizationRemarks::enabled()) {
+      remarkFunction.objectName = file->getStringValue(object->name);
+      if (state)
+        remarkFunction.stateName = file->getStringValue(state->name);
+      remarkFunction.functionName = propertyName != "" ? identifier_ref(propertyName) : file->getStringValue(function->name);
+      remarkFunction.functionType = functionType;
+      if (debInfo && debInfo->instructionLineMap.size())
+        remarkFunction.line = debInfo->instructionLineMap[0];
+    }
+    FunctionOptimizer opt{ file, object, function, debInfo, PexOptimizationRemarks::enabled() ? &remarkFunction : nullptr };
+    auto level = conf::CodeGeneration::optimizationLevel;
+    if (function->hotness == CapricaProfileHotness::Hot)
+      level = std::max<size_t>(level, 2);
+    else if (function->hotness == CapricaProfileHotness::Cold)
+      level = std::min<size_t>(level, 1);
+    opt.optimize(level);
+    opt.lower();
+  }
+  stats.instructionsAfter += function->instructions.size();
 }
 
 }}
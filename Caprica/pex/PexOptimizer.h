@@ -1,23 +1,44 @@
 #pragma once
 
+#include <string>
+
 #include <pex/PexFile.h>
 
 namespace caprica { namespace pex {
 struct PexOptimizer final
 {
-  static void optimize(PexFile* file) {
+  struct Statistics final
+  {
+    size_t instructionsBefore{ 0 };
+    size_t instructionsAfter{ 0 };
+  };
+
+  // Optimize every function in the file according to
+  // conf::CodeGeneration::optimizationLevel, adjusted by
+  // the hotness of each function when there is a profile.
+  static Statistics optimize(PexFile* file) {
     PexOptimizer opt{ };
     for (auto o : file->objects)
       opt.optimize(file, o);
+    return opt.stats;
   }
 
 private:
+  Statistics stats{ };
+
   PexOptimizer() = default;
   ~PexOptimizer() = default;
 
   void optimize(PexFile* file, PexObject* object) {
     for (auto s : object->states)
       optimize(file, object, s);
+    for (auto p : object->properties) {
+      auto propName = file->getStringValue(p->name).to_string();
+      if (p->readFunction)
+        optimize(file, object, nullptr, p->readFunction, propName, PexDebugFunctionType::Getter);
+      if (p->writeFunction)
+        optimize(file, object, nullptr, p->writeFunction, propName, PexDebugFunctionType::Setter);
+    }
   }
 
   void optimize(PexFile* file, PexObject* object, PexState* state) {
@@ -0,0 +1,366 @@
+#include <pex/PexPeepholeOptimizer.h>
+
+#include <atomic>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include <common/CaselessStringComparer.h>
+
+#include <pex/PexOptimizationRemarks.h>
+
+namespace caprica { namespace pex {
+
+namespace {
+
+struct PeepholeFunction final
+{
+  PexFile* file;
+  PexFunction* function;
+  std::vector<PexInstruction*> instructions{ };
+  std::vector<uint16_t> lines{ };
+  std::vector<bool> removed{ };
+  std::vector<bool> isBranchTarget{ };
+  std::unordered_map<size_t, PexString> localTypes{ };
+  // Scratch for isDeadAfter, kept between queries so they don't
+  // allocate or clear anything. An instruction has been visited
+  // by the current query if its stamp is visitStamp.
+  std::vector<uint32_t> visitedStamps{ };
+  uint32_t visitStamp{ 0 };
+  std::vector<size_t> worklist{ };
+
+  PeepholeFunction(PexFile* file, PexFunction* function, const PexDebugFunctionInfo* debInfo)
+    : file(file), function(function) {
+    instructions.reserve(function->instructions.size());
+    for (auto i : function->instructions)
+      instructions.push_back(i);
+    if (debInfo && debInfo->instructionLineMap.size() == instructions.size())
+      lines = debInfo->instructionLineMap;
+
+    for (auto p : function->parameters)
+      localTypes.emplace(p->name.index, p->type);
+    for (auto l : function->locals)
+      localTypes.emplace(l->name.index, l->type);
+    resetFlags();
+  }
+
+  void resetFlags() {
+    removed.assign(instructions.size(), false);
+    isBranchTarget.assign(instructions.size() + 1, false);
+    visitedStamps.assign(instructions.size(), 0);
+    visitStamp = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+      if (instructions[i]->isBranch())
+        isBranchTarget[(size_t)((int64_t)i + instructions[i]->branchTarget())] = true;
+    }
+  }
+
+  bool isLocal(const PexValue& v) const {
+    return v.type == PexValueType::Identifier && localTypes.count(v.val.s.index);
+  }
+
+  // Returns an invalid string if the type isn't known, which
+  // is the case for literals and object variables.
+  PexString typeOf(const PexValue& v) const {
+    if (v.type == PexValueType::Identifier) {
+      auto f = localTypes.find(v.val.s.index);
+      if (f != localTypes.end())
+        return f->second;
+    }
+    return PexString();
+  }
+
+  bool literalMatchesType(const PexValue& v, PexString type) const {
+    auto typeName = file->getStringValue(type);
+    switch (v.type) {
+      case PexValueType::Integer:
+        return idEq(typeName, "int");
+      case PexValueType::Float:
+        return idEq(typeName, "float");
+      case PexValueType::Bool:
+        return idEq(typeName, "bool");
+      case PexValueType::String:
+        return idEq(typeName, "string");
+      default:
+        return false;
+    }
+  }
+
+  static bool reads(PexInstruction* instr, const PexValue& var) {
+    bool found = false;
+    instr->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+      if (v == var)
+        found = true;
+    });
+    return found;
+  }
+
+  static bool writes(const PexInstruction* instr, const PexValue& var) {
+    auto destIdx = PexInstruction::getDestArgIndexForOpCode(instr->opCode);
+    return destIdx != -1 && instr->args[destIdx] == var;
+  }
+
+  // True if no path from the instruction after idx reads the local
+  // before writing to it.
+  bool isDeadAfter(size_t idx, const PexValue& var) {
+    if (!isLocal(var))
+      return false;
+
+    if (++visitStamp == 0) {
+      visitedStamps.assign(instructions.size(), 0);
+      visitStamp = 1;
+    }
+    worklist.clear();
+    const auto pushSuccessors = [&](size_t i) {
+      auto instr = instructions[i];
+      if (!removed[i]) {
+        if (instr->opCode == PexOpCode::Return)
+          return;
+        if (instr->isBranch())
+          worklist.push_back((size_t)((int64_t)i + instr->branchTarget()));
+        if (instr->opCode == PexOpCode::Jmp)
+          return;
+      }
+      worklist.push_back(i + 1);
+    };
+
+    pushSuccessors(idx);
+    while (worklist.size()) {
+      auto i = worklist.back();
+      worklist.pop_back();
+      if (i >= instructions.size() || visitedStamps[i] == visitStamp)
+        continue;
+      visitedStamps[i] = visitStamp;
+      if (!removed[i]) {
+        if (reads(instructions[i], var))
+          return false;
+        if (writes(instructions[i], var))
+          continue;
+      }
+      pushSuccessors(i);
+    }
+    return true;
+  }
+
+  // Drop the removed instructions, fixing up branch targets
+  // and the line map to match.
+  void compact() {
+    std::vector<size_t> newIndices(instructions.size() + 1, 0);
+    size_t cur = 0;
+    for (size_t i = 0; i < instructions.size(); i++) {
+      newIndices[i] = cur;
+      if (!removed[i])
+        cur++;
+    }
+    newIndices[instructions.size()] = cur;
+
+    std::vector<PexInstruction*> newInstructions{ };
+    std::vector<uint16_t> newLines{ };
+    newInstructions.reserve(cur);
+    newLines.reserve(lines.size() ? cur : 0);
+    for (size_t i = 0; i < instructions.size(); i++) {
+      if (removed[i])
+        continue;
+      auto instr = instructions[i];
+      if (instr->isBranch()) {
+        auto target = (size_t)((int64_t)i + instr->branchTarget());
+        instr->setBranchTarget((int)newIndices[target] - (int)newIndices[i]);
+      }
+      newInstructions.push_back(instr);
+      if (lines.size())
+        newLines.push_back(lines[i]);
+    }
+    instructions = std::move(newInstructions);
+    lines = std::move(newLines);
+    resetFlags();
+  }
+};
+
+// The instructions starting at idx matched the pattern's opcodes.
+// Returns the number of instructions removed, or 0 if the operands
+// didn't fit.
+using PeepholeRewrite = size_t(*)(PeepholeFunction& func, size_t idx);
+
+// not t2, t; jmpf t2, L -> jmpt t, L
+// PexOptimizer's removeDeadStores does the same, but only at level
+// 2. This catches it at level 1, which is what -O1 uses, and what
+// functions the profile marks as cold are capped at.
+static size_t foldNotIntoBranch(PeepholeFunction& func, size_t idx) {
+  auto notInstr = func.instructions[idx];
+  auto branch = func.instructions[idx + 1];
+  auto& tmp = notInstr->args[0];
+  if (branch->args[0] != tmp || !func.isDeadAfter(idx + 1, tmp))
+    return 0;
+
+  branch->opCode = branch->opCode == PexOpCode::JmpF ? PexOpCode::JmpT : PexOpCode::JmpF;
+  branch->args[0] = notInstr->args[1];
+  func.removed[idx] = true;
+  return 1;
+}
+
+// cast t, x; cast t2, t -> cast t2, x when t and t2 are the same type,
+// as the second cast can't change the value.
+static size_t foldIdentityCast(PeepholeFunction& func, size_t idx) {
+  auto first = func.instructions[idx];
+  auto second = func.instructions[idx + 1];
+  auto& tmp = first->args[0];
+  if (second->args[1] != tmp)
+    return 0;
+  auto type = func.typeOf(tmp);
+  if (!type.valid() || func.typeOf(second->args[0]) != type)
+    return 0;
+
+  if (second->args[0] != tmp) {
+    if (!func.isDeadAfter(idx + 1, tmp))
+      return 0;
+    first->args[0] = second->args[0];
+  }
+  func.removed[idx + 1] = true;
+  // The remaining cast is the one that did the work, so
+  // it keeps its own line.
+  return 1;
+}
+
+// assign t, x; op ..., t, ... -> op ..., x, ... when t is dead
+// afterwards.
+static size_t forwardAssign(PeepholeFunction& func, size_t idx) {
+  auto assign = func.instructions[idx];
+  auto user = func.instructions[idx + 1];
+  auto& tmp = assign->args[0];
+  auto& src = assign->args[1];
+  if (tmp == src)
+    return 0;
+
+  auto type = func.typeOf(tmp);
+  if (!type.valid())
+    return 0;
+  if (src.type == PexValueType::Identifier) {
+    if (func.typeOf(src) != type)
+      return 0;
+  } else if (!func.literalMatchesType(src, type)) {
+    return 0;
+  }
+
+  bool usesTmp = false;
+  bool fits = true;
+  user->forEachReadArg([&](PexValue& v, PexInstructionArgKind kind) {
+    if (v == tmp) {
+      usesTmp = true;
+      if (kind == PexInstructionArgKind::Identifier && src.type != PexValueType::Identifier)
+        fits = false;
+    }
+  });
+  if (!usesTmp || !fits)
+    return 0;
+  if (!PeepholeFunction::writes(user, tmp) && !func.isDeadAfter(idx + 1, tmp))
+    return 0;
+
+  user->forEachReadArg([&](PexValue& v, PexInstructionArgKind) {
+    if (v == tmp)
+      v = src;
+  });
+  func.removed[idx] = true;
+  return 1;
+}
+
+struct PeepholePattern final
+{
+  const char* name;
+  size_t length;
+  // PexOpCode::Invalid matches any instruction.
+  PexOpCode opCodes[2];
+  PeepholeRewrite rewrite;
+};
+
+// Earlier patterns take priority over later ones.
+static const PeepholePattern patterns[] = {
+  { "not/jmpf", 2, { PexOpCode::Not, PexOpCode::JmpF }, foldNotIntoBranch },
+  { "not/jmpt", 2, { PexOpCode::Not, PexOpCode::JmpT }, foldNotIntoBranch },
+  { "cast/cast", 2, { PexOpCode::Cast, PexOpCode::Cast }, foldIdentityCast },
+  { "assign/propset", 2, { PexOpCode::Assign, PexOpCode::PropSet }, forwardAssign },
+  { "assign/any", 2, { PexOpCode::Assign, PexOpCode::Invalid }, forwardAssign },
+};
+static constexpr size_t PatternCount = sizeof(patterns) / sizeof(patterns[0]);
+static std::atomic<size_t> removedByPattern[PatternCount]{ };
+
+}
+
+void PexPeepholeOptimizer::optimize(PexFile* file,
+                                    PexObject* object,
+                                    PexState* state,
+                                    PexFunction* function,
+                                    const std::string& propertyName,
+                                    PexDebugFunctionType functionType) {
+  if (function->instructions.size() < 2)
+    return;
+
+  auto debInfo = file->tryFindFunctionDebugInfo(object, state, function, propertyName, functionType);
+  PeepholeFunction func{ file, function, debInfo };
+
+  size_t removedInFunction = 0;
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (size_t i = 0; i < func.instructions.size(); i++) {
+      for (size_t p = 0; p < PatternCount; p++) {
+        auto& pattern = patterns[p];
+        if (i + pattern.length > func.instructions.size())
+          continue;
+
+        bool matches = true;
+        for (size_t j = 0; j < pattern.length && matches; j++) {
+          auto op = pattern.opCodes[j];
+          if (func.removed[i + j] || (op != PexOpCode::Invalid && func.instructions[i + j]->opCode != op))
+            matches = false;
+          // Something else branches into the middle of the sequence.
+          if (j != 0 && func.isBranchTarget[i + j])
+            matches = false;
+        }
+        if (!matches)
+          continue;
+
+        auto count = pattern.rewrite(func, i);
+        if (count) {
+          removedByPattern[p] += count;
+          removedInFunction += count;
+          changed = true;
+          i += pattern.length - 1;
+          break;
+        }
+      }
+    }
+    if (changed)
+      func.compact();
+  }
+
+  if (!removedInFunction)
+    return;
+
+  if (PexOptimizationRemarks::enabled()) {
+    PexOptimizationRemarks::Function remarkFunction{ };
+    remarkFunction.objectName = file->getStringValue(object->name);
+    if (state)
+      remarkFunction.stateName = file->getStringValue(state->name);
+    remarkFunction.functionName = propertyName != "" ? identifier_ref(propertyName) : file->getStringValue(function->name);
+    remarkFunction.functionType = functionType;
+    if (func.lines.size())
+      remarkFunction.line = func.lines[0];
+    // The rewrites don't add or remove locals.
+    auto temps = PexOptimizationRemarks::countTemps(file, function->locals);
+    PexOptimizationRemarks::emit(remarkFunction, "peephole", func.instructions.size() + removedInFunction, func.instructions.size(), temps, temps);
+  }
+
+  IntrusiveLinkedList<PexInstruction> newInstructions{ };
+  for (auto i : func.instructions)
+    newInstructions.push_back(i);
+  function->instructions = std::move(newInstructions);
+  if (func.lines.size())
+    debInfo->instructionLineMap = std::move(func.lines);
+  removedInstructions += removedInFunction;
+}
+
+void PexPeepholeOptimizer::outputStats() {
+  for (size_t p = 0; p < PatternCount; p++)
+    std::cout << "Peephole " << patterns[p].name << ": " << removedByPattern[p] << " instructions removed" << std::endl;
+}
+
+}}
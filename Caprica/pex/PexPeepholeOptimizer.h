@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+
+#include <pex/PexFile.h>
+
+namespace caprica { namespace pex {
+
+// Collapses short instruction sequences that codegen
+// commonly emits. This runs after PexOptimizer.
+struct PexPeepholeOptimizer final
+{
+  // Returns the number of instructions removed.
+  static size_t optimize(PexFile* file) {
+    PexPeepholeOptimizer opt{ };
+    for (auto o : file->objects)
+      opt.optimize(file, o);
+    return opt.removedInstructions;
+  }
+
+  // Output the number of instructions removed by each
+  // pattern across every file optimized.
+  static void outputStats();
+
+private:
+  size_t removedInstructions{ 0 };
+
+  PexPeepholeOptimizer() = default;
+  ~PexPeepholeOptimizer() = default;
+
+  void optimize(PexFile* file, PexObject* object) {
+    for (auto s : object->states) {
+      for (auto f : s->functions)
+        optimize(file, object, s, f, "", PexDebugFunctionType::Normal);
+    }
+    for (auto p : object->properties) {
+      auto propName = file->getStringValue(p->name).to_string();
+      if (p->readFunction)
+        optimize(file, object, nullptr, p->readFunction, propName, PexDebugFunctionType::Getter);
+      if (p->writeFunction)
+        optimize(file, object, nullptr, p->writeFunction, propName, PexDebugFunctionType::Setter);
+    }
+  }
+
+  void optimize(PexFile* file,
+                PexObject* object,
+                PexState* state,
+                PexFunction* function,
+                const std::string& propertyName,
+                PexDebugFunctionType functionType);
+};
+
+}}
@@ -1,9 +1,8 @@
 #pragma once
 
 #include <cstdint>
-#include <fstream>
-#include <iostream>
 #include <string>
+#include <string_view>
 
 #include <common/CapricaBinaryReader.h>
 #include <common/CapricaReportingContext.h>
@@ -16,7 +15,7 @@ namespace caprica { namespace pex {
 
 struct PexReader final : public CapricaBinaryReader
 {
-  explicit PexReader(const std::string& file) : CapricaBinaryReader(file) { }
+  explicit PexReader(std::string_view data) : CapricaBinaryReader(data) { }
   PexReader(const PexReader&) = delete;
   ~PexReader() = default;
 
@@ -28,16 +27,14 @@ struct PexReader final : public CapricaBinaryReader
   template<>
   PexString read() {
     PexString val;
-    val.index = 0;
-    strm.read((char*)&val.index, sizeof(uint16_t));
+    val.index = read<uint16_t>();
     return val;
   }
 
   template<>
   PexUserFlags read() {
     PexUserFlags val;
-    val.data = 0;
-    strm.read((char*)&val.data, sizeof(uint32_t));
+    val.data = read<uint32_t>();
     return val;
   }
 
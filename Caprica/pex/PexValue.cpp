@@ -12,16 +12,18 @@ void PexValue::writeAsm(const PexFile* file, PexAsmWriter& wtr) const {
       wtr.write("None");
       return;
     case PexValueType::Identifier:
-      wtr.write("%s", file->getStringValue(val.s).to_string().c_str());
+      wtr.write(file->getStringValue(val.s));
       return;
     case PexValueType::String:
-      wtr.write("\"%s\"", PexAsmWriter::escapeString(file->getStringValue(val.s).to_string()).c_str());
+      wtr.write('"');
+      wtr.writeEscaped(file->getStringValue(val.s));
+      wtr.write('"');
       return;
     case PexValueType::Integer:
-      wtr.write("%i", (int)val.i);
+      wtr.write((int)val.i);
       return;
     case PexValueType::Float:
-      wtr.write("%f", val.f);
+      wtr.write(val.f);
       return;
     case PexValueType::Bool:
       if (val.b)
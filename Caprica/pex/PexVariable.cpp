@@ -23,7 +23,7 @@ void PexVariable::write(PexWriter& wtr) const {
 }
 
 void PexVariable::writeAsm(const PexFile* file, PexAsmWriter& wtr) const {
-  wtr.write(".variable %s %s", file->getStringValue(name).to_string().c_str(), file->getStringValue(typeName).to_string().c_str());
+  wtr.write(".variable ", file->getStringValue(name), ' ', file->getStringValue(typeName));
   if (isConst)
     wtr.write(" const");
   wtr.writeln();
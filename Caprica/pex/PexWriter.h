@@ -64,18 +64,21 @@ struct PexWriter final : public CapricaBinaryWriter
   }
 
   void beginObject() {
-    objectLength = strm.make<uint32_t>();
-    objectStartSize = strm.totalAllocatedBytes();
+    // The buffer may move before the length is known, so
+    // remember where it goes rather than a pointer to it.
+    objectLengthOffset = length;
+    put<uint32_t>(0);
+    objectStartSize = length;
   }
 
   void endObject() {
-    assert(strm.totalAllocatedBytes() - objectStartSize <= std::numeric_limits<uint32_t>::max());
-    *objectLength = (uint32_t)(strm.totalAllocatedBytes() - objectStartSize);
-    objectLength = nullptr;
+    assert(length - objectStartSize <= std::numeric_limits<uint32_t>::max());
+    auto objectLength = (uint32_t)(length - objectStartSize);
+    memcpy(buffer + objectLengthOffset, &objectLength, sizeof(uint32_t));
   }
 
 private:
-  uint32_t* objectLength{ nullptr };
+  size_t objectLengthOffset{ 0 };
   size_t objectStartSize{ 0 };
 };
 